@@ -1,6 +1,8 @@
-/* File CExamples/arrays.c */
+/* File CExamples/arrays.c
+   Compile as "gcc -Wall -std=c99 arrays.c matrix.c" */
 #include <stdio.h>
 #include <stdlib.h> /* for calloc */
+#include "matrix.h"
 int main(void)
 {int digits[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
  /* the dimension is optional and will be determined by the compiler
@@ -13,6 +15,8 @@ int main(void)
                    {3.0, 3.1, 3.2, 3.3, 3.4, 3.5},
                    {4.0, 4.1, 4.2, 4.3, 4.4, 4.5}};
  int i, j;
+ matrix m, m2; /* see matrix.h */
+ float** mrow;
 
  printf("digits[4] == %d, *(digits+4) == %d\n\n", digits[4], *(digits+4) );
 
@@ -50,5 +54,31 @@ int main(void)
         *(float*)((unsigned char*)xptr[2] + sizeof(float)*3) );
 
  for(i=0; i<5; i++) free(xptr[i]);
+
+ /* the rows in one aligned block, as in xy, but allocated at run time;
+    m.stride floats from one row to the next */
+ if(matrix_alloc(&m, MATRIX_FLOAT, 5, 6) != 0)
+   {fprintf(stderr, "Out of memory\n");
+    return 1;
+   }
+ for(i=0; i<5; i++)
+    for(j=0; j<6; j++)
+       MATRIX_F(&m, i, j) = i + 0.1 * j;
+ mrow = matrix_frows(&m); /* row pointers, as xptr */
+ if(mrow == NULL)
+   {fprintf(stderr, "Out of memory\n");
+    matrix_free(&m);
+    return 1;
+   }
+
+ printf("m.stride == %lu\n\n", (unsigned long)m.stride);
+ printf("1. MATRIX_F(&m, 2, 3)                 == %4.1f\n\n", MATRIX_F(&m, 2, 3));
+ printf("2. *((float*)m.data + 2*m.stride + 3) == %4.1f\n\n",
+        *((float*)m.data + 2*m.stride + 3));
+ printf("3. mrow[2][3]                         == %4.1f\n\n", mrow[2][3]);
+ m2 = matrix_sub(&m, 1, 2, 3, 3); /* rows 1..3, columns 2..4 */
+ printf("4. MATRIX_F(&m2, 1, 1)                == %4.1f\n\n", MATRIX_F(&m2, 1, 1));
+
+ matrix_free(&m);
  return 0;
 }
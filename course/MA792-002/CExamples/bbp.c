@@ -0,0 +1,135 @@
+/*
+ * File: CExamples/bbp.c
+ * Computation of the n'th hexadecimal digit of pi with the formula of
+ * Bailey, Borwein and Plouffe (1995):
+ *
+ * pi = sum( 16^(-k) * (4/(8k+1) - 2/(8k+4) - 1/(8k+5) - 1/(8k+6)), k=0..infinity);
+ *
+ * Multiplying by 16^(n-1) and keeping the fractional part, the terms with
+ * k < n only need 16^(n-1-k) mod (8k+j), which pow_mod from pimod.h gives
+ * us; the terms with k >= n are small and are summed in floating point.
+ * This is O(n log n), against O(n^2) for the decimal method of pi1.c.
+ *
+ * The k-range is cut into one slice per thread.
+ *
+ * Compile as "gcc -Wall -O2 -pthread -o bbp bbp.c -lm"
+ * Run as     "bbp n [threads]"
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "pimod.h"
+
+#define MAX_THREADS 256
+
+/* the moduli 8k+j go up to 8n; the fmod() mul_mod is exact below 2^26 */
+#ifdef HAS_LONG_LONG
+#define MAX_N (1<<27)
+#else
+#define MAX_N (1<<22)
+#endif
+
+/* work for one thread: the fractional part of
+   sum( 4*f(1) - 2*f(4) - f(5) - f(6), k=k0..k1-1 ), f(j) = 16^(d-k)/(8k+j) */
+struct slice {
+  int d,k0,k1;
+  double s;
+};
+
+/* fractional part of sum(16^(d-k) mod (8k+j) / (8k+j), k=k0..k1-1), k1<=d+1 */
+double head_sum(int j,int d,int k0,int k1)
+{
+  int k,m;
+  double s;
+
+  s=0;
+  for(k=k0;k<k1;k++) {
+    m=8*k+j;
+    s+=(double) pow_mod(16,d-k,m) / (double) m;
+    s-=floor(s);
+  }
+  return s;
+}
+
+/* sum(16^(d-k)/(8k+j), k=d+1..infinity), to double precision */
+double tail_sum(int j,int d)
+{
+  int k;
+  double s,p;
+
+  s=0;
+  p=1.0/16;
+  for(k=d+1;p>1e-17;k++) {
+    s+=p/(8*k+j);
+    p=p/16;
+  }
+  return s;
+}
+
+void *slice_main(void *arg)
+{
+  struct slice *sl=arg;
+  double s;
+
+  s=4*head_sum(1,sl->d,sl->k0,sl->k1)
+    -2*head_sum(4,sl->d,sl->k0,sl->k1)
+    -head_sum(5,sl->d,sl->k0,sl->k1)
+    -head_sum(6,sl->d,sl->k0,sl->k1);
+  sl->s=s-floor(s);
+  return NULL;
+}
+
+/* return the fractional part of 16^(n-1)*pi, using nthreads threads */
+double bbp_frac(int n,int nthreads)
+{
+  struct slice sl[MAX_THREADS];
+  pthread_t tid[MAX_THREADS];
+  int started[MAX_THREADS];
+  int i,d,nk;
+  double s;
+
+  d=n-1;
+  nk=d+1;
+  if (nthreads>nk) nthreads=nk;
+  if (nthreads<1) nthreads=1;
+  for(i=0;i<nthreads;i++) {
+    sl[i].d=d;
+    sl[i].k0=(int)((long long)nk*i/nthreads);
+    sl[i].k1=(int)((long long)nk*(i+1)/nthreads);
+  }
+  /* slices whose thread cannot be started are done by this thread */
+  for(i=1;i<nthreads;i++)
+    started[i]=pthread_create(&tid[i],NULL,slice_main,&sl[i])==0;
+  slice_main(&sl[0]);
+  for(i=1;i<nthreads;i++)
+    if (started[i]) pthread_join(tid[i],NULL);
+    else slice_main(&sl[i]);
+
+  s=4*tail_sum(1,d)-2*tail_sum(4,d)-tail_sum(5,d)-tail_sum(6,d);
+  for(i=0;i<nthreads;i++) s+=sl[i].s;
+  return s-floor(s);
+}
+
+int main(int argc,char *argv[])
+{
+  int n,nthreads;
+  double x;
+
+  if (argc<2 || (n=atoi(argv[1])) <= 0 || n>MAX_N) {
+    printf("This program computes the n'th hexadecimal digit of pi\n"
+	   "usage: bbp n [threads] , where 0 < n <= %d is the digit you want\n",
+	   MAX_N);
+    exit(1);
+  }
+  nthreads=1;
+  if (argc>=3) nthreads=atoi(argv[2]);
+  if (nthreads>MAX_THREADS) nthreads=MAX_THREADS;
+
+  x=bbp_frac(n,nthreads);
+  printf("Hexadecimal digits of pi at position %d: %08lX\n",n,
+	 (unsigned long)(x*4294967296.0));
+  return 0;
+}
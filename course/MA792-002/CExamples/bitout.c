@@ -0,0 +1,225 @@
+/* File: CExamples/bitout.c
+   Buffered output of packed random bits; see bitout.h.
+   Each 64-bit word is expanded to 64 ASCII characters with AVX2 or
+   SSSE3 byte shuffles when the compiler targets them (-march=native),
+   and with a 256 entry table otherwise.
+   Compile with the program using it, e.g.
+              "gcc -Wall -std=c99 -O2 -march=native rand.c bitout.c" */
+
+#define _GNU_SOURCE /* for vmsplice and F_SETPIPE_SZ */
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/uio.h> /* for vmsplice */
+#endif
+#if defined(__AVX2__) || defined(__SSSE3__)
+#include <immintrin.h>
+#endif
+#include "bitout.h"
+
+#define STAGE_WORDS 1024     /* words expanded at a time */
+#define DEFAULT_CAP (1 << 20) /* bytes per buffer half */
+#define PAGE 4096
+
+#if defined(__AVX2__)
+/* expand the 64 bits of w into '0'/'1' characters at p, LSB first */
+static void expand64(char *p, uint64_t w)
+{/* byte i of the result looks at byte i/8 of the (broadcast) half word;
+    vpshufb works within 128-bit lanes, each holding the 4 bytes */
+ const __m256i shuf = _mm256_setr_epi8(0,0,0,0,0,0,0,0, 1,1,1,1,1,1,1,1,
+                                       2,2,2,2,2,2,2,2, 3,3,3,3,3,3,3,3);
+ const __m256i bit = _mm256_set1_epi64x((long long)0x8040201008040201ULL);
+ const __m256i zero = _mm256_set1_epi8('0');
+ __m256i v;
+ v = _mm256_shuffle_epi8(_mm256_set1_epi32((int)(uint32_t)w), shuf);
+ v = _mm256_cmpeq_epi8(_mm256_and_si256(v, bit), bit);
+ _mm256_storeu_si256((__m256i*)p, _mm256_sub_epi8(zero, v));
+ v = _mm256_shuffle_epi8(_mm256_set1_epi32((int)(uint32_t)(w >> 32)), shuf);
+ v = _mm256_cmpeq_epi8(_mm256_and_si256(v, bit), bit);
+ _mm256_storeu_si256((__m256i*)(p + 32), _mm256_sub_epi8(zero, v));
+}
+#elif defined(__SSSE3__)
+static void expand64(char *p, uint64_t w)
+{const __m128i shuf = _mm_setr_epi8(0,0,0,0,0,0,0,0, 1,1,1,1,1,1,1,1);
+ const __m128i bit = _mm_set1_epi64x((long long)0x8040201008040201ULL);
+ const __m128i zero = _mm_set1_epi8('0');
+ __m128i v;
+ int i;
+ for(i=0; i<4; i++)
+    {v = _mm_shuffle_epi8(_mm_cvtsi32_si128((int)(w >> 16*i)), shuf);
+     v = _mm_cmpeq_epi8(_mm_and_si128(v, bit), bit);
+     _mm_storeu_si128((__m128i*)(p + 16*i), _mm_sub_epi8(zero, v));
+    }
+}
+#else
+static char expand_table[256][8]; /* the 8 characters for each byte */
+
+static void expand64(char *p, uint64_t w)
+{int i, j;
+ if(expand_table[1][0] != '1')
+    for(i=0; i<256; i++)
+       for(j=0; j<8; j++) expand_table[i][j] = '0' + ((i >> j) & 1);
+ for(i=0; i<8; i++, w >>= 8)
+    memcpy(p + 8*i, expand_table[w & 0xff], 8);
+}
+#endif
+
+/* write all n bytes at p to fd, restarting after signals */
+static int write_all(int fd, const char *p, size_t n)
+{ssize_t r;
+ while(n > 0)
+   {r = write(fd, p, n);
+    if(r < 0)
+      {if(errno == EINTR) continue;
+       return -1;
+      }
+    p += r; n -= (size_t)r;
+   }
+ return 0;
+}
+
+#ifdef __linux__
+/* hand the pages at p to the pipe fd instead of copying them; the caller
+   must not touch them until a whole pipe's worth has been written after */
+static int splice_all(int fd, char *p, size_t n)
+{struct iovec iov;
+ ssize_t r;
+ while(n > 0)
+   {iov.iov_base = p; iov.iov_len = n;
+    r = vmsplice(fd, &iov, 1, 0);
+    if(r < 0)
+      {if(errno == EINTR) continue;
+       return -1;
+      }
+    p += r; n -= (size_t)r;
+   }
+ return 0;
+}
+#endif
+
+int bitout_open(bitout *o, int fd, int width, size_t cap)
+{void *mem;
+ if(cap == 0) cap = DEFAULT_CAP;
+ o->fd = fd;
+ o->width = width;
+ o->col = 0;
+ o->splice = 0;
+ o->len = 0;
+ o->half = 0;
+ o->nbits = 0;
+#ifdef __linux__
+ {struct stat st;
+  int pipe_sz;
+  if(width == 0 && fstat(fd, &st) == 0 && S_ISFIFO(st.st_mode))
+    {/* each half must hold at least a full pipe: once one half has
+        been spliced completely, the other one is out of the pipe */
+     (void)fcntl(fd, F_SETPIPE_SZ, (int)cap);
+     pipe_sz = fcntl(fd, F_GETPIPE_SZ);
+     if(pipe_sz > 0)
+       {if((size_t)pipe_sz > cap) cap = (size_t)pipe_sz;
+        o->splice = 1;
+       }
+    }
+ }
+#endif
+ cap = (cap + PAGE - 1) / PAGE * PAGE;
+ if(cap < (size_t)width + 1) cap = ((size_t)width + PAGE) / PAGE * PAGE;
+ o->cap = cap;
+ if(posix_memalign(&mem, PAGE, 2*cap) != 0) return -1;
+ o->buf = mem;
+ o->stage = NULL;
+ if(width > 0)
+   {if(posix_memalign(&mem, 64, 64*STAGE_WORDS) != 0)
+      {free(o->buf);
+       return -1;
+      }
+    o->stage = mem;
+   }
+ return 0;
+}
+
+int bitout_flush(bitout *o)
+{char *p = o->buf + o->half * o->cap;
+ int r;
+ if(o->len == 0) return 0;
+#ifdef __linux__
+ if(o->splice)
+   {r = splice_all(o->fd, p, o->len);
+    if(r < 0 && (errno == EINVAL || errno == ENOSYS))
+      {o->splice = 0; /* not supported here, fall back to write */
+       r = write_all(o->fd, p, o->len);
+      }
+   }
+ else
+#endif
+    r = write_all(o->fd, p, o->len);
+ o->len = 0;
+ o->half = 1 - o->half;
+ return r;
+}
+
+int bitout_words(bitout *o, const uint64_t *w, size_t n)
+{char *out, *p;
+ size_t m, i, k, left;
+
+ o->nbits += 64 * (uint64_t)n;
+ if(o->width == 0)
+   {/* raw: the bytes of the words, in host byte order */
+    while(n > 0)
+      {m = (o->cap - o->len) / sizeof(uint64_t);
+       if(m == 0)
+         {if(bitout_flush(o) < 0) return -1;
+          continue;
+         }
+       if(m > n) m = n;
+       memcpy(o->buf + o->half * o->cap + o->len, w, m * sizeof(uint64_t));
+       o->len += m * sizeof(uint64_t);
+       w += m; n -= m;
+      }
+    return 0;
+   }
+
+ while(n > 0)
+   {m = n < STAGE_WORDS ? n : STAGE_WORDS;
+    for(i=0; i<m; i++) expand64(o->stage + 64*i, w[i]);
+    w += m; n -= m;
+
+    /* cut the characters into rows */
+    p = o->stage;
+    left = 64*m;
+    while(left > 0)
+      {k = (size_t)(o->width - o->col);
+       if(k > left) k = left;
+       if(o->cap - o->len < k + 1 && bitout_flush(o) < 0) return -1;
+       out = o->buf + o->half * o->cap + o->len;
+       memcpy(out, p, k);
+       o->len += k; p += k; left -= k;
+       o->col += (int)k;
+       if(o->col == o->width)
+         {out[k] = '\n';
+          o->len++;
+          o->col = 0;
+         }
+      }
+   }
+ return 0;
+}
+
+int bitout_close(bitout *o)
+{int r;
+ if(o->width > 0 && o->col > 0)
+   {/* end the last, short row */
+    if(o->len == o->cap && bitout_flush(o) < 0) return -1;
+    o->buf[o->half * o->cap + o->len++] = '\n';
+    o->col = 0;
+   }
+ r = bitout_flush(o);
+ free(o->buf);
+ free(o->stage);
+ o->buf = o->stage = NULL;
+ return r;
+}
@@ -0,0 +1,41 @@
+/* File: CExamples/bitout.h
+   Buffered output of packed random bits, for rand.c and rand2.c.
+   Bits are given as 64-bit words and are written least significant
+   bit first, either as rows of '0'/'1' characters ended by '\n'
+   (width > 0), or raw, as the bytes of the words (width == 0).
+   Output is collected in a large page aligned buffer and written
+   with write(2); raw output into a pipe uses vmsplice(2) on Linux. */
+
+#ifndef BITOUT_H
+#define BITOUT_H
+
+#include <stdint.h>
+#include <stddef.h> /* for size_t */
+
+typedef struct {
+  int fd;         /* file descriptor written to */
+  int width;      /* bits per row, 0 for raw binary output */
+  int col;        /* bits already on the current row */
+  int splice;     /* 1 if raw output goes to a pipe through vmsplice */
+  char *buf;      /* page aligned output buffer of 2*cap bytes */
+  size_t cap;     /* bytes in each half of buf */
+  size_t len;     /* bytes waiting in the current half */
+  int half;       /* the half of buf that is being filled */
+  char *stage;    /* expanded ASCII bits of one block of words */
+  uint64_t nbits; /* bits accepted so far */
+} bitout;
+
+/* set up o for writing to fd; cap is the buffer size in bytes (0 for
+   the default); return 0, or -1 if out of memory */
+int bitout_open(bitout *o, int fd, int width, size_t cap);
+
+/* append the 64*n bits of w[0..n-1]; return 0, or -1 on a write error */
+int bitout_words(bitout *o, const uint64_t *w, size_t n);
+
+/* write out what is buffered; return 0, or -1 on a write error */
+int bitout_flush(bitout *o);
+
+/* flush and free the buffers (fd is not closed); return as bitout_flush */
+int bitout_close(bitout *o);
+
+#endif /* BITOUT_H */
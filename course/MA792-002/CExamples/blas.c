@@ -0,0 +1,264 @@
+/* File: CExamples/blas.c
+   Vector and matrix kernels; see blas.h.  The kernels themselves are
+   in blas_kernel.h, which is compiled here once per element type and
+   instruction set; a table of function pointers for each instruction
+   set is chosen on the first call, from what the processor reports.
+   Compile with the program using it, e.g.
+      "gcc -Wall -std=c99 -O3 -ffp-contract=fast -pthread blas_bench.c blas.c matrix.c"
+   -ffp-contract=fast lets the compiler fuse a*b+c into one FMA
+   instruction, which -std=c99 does not allow by default; it doubles
+   the speed of the AVX kernels.  -march=native is not needed. */
+
+#define _POSIX_C_SOURCE 200112L /* for posix_memalign and sysconf */
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "blas.h"
+
+#define KC 256  /* depth of the blocks of A and B */
+#define MC 120  /* rows of the block of A, a multiple of MR = 6 */
+#define NC 2048 /* columns of the block of B, a multiple of every NR */
+
+#define CAT_(a, b, c) a##_##b##_##c
+#define CAT(a, b, c) CAT_(a, b, c)
+
+/* ---------- the kernels, per instruction set ---------- */
+
+/* 16 byte vectors are SSE2 on x86-64 and NEON on ARM */
+#define TARGET
+#define VB 16
+#define T float
+#define NAME(f) CAT(f, s, generic)
+#include "blas_kernel.h"
+#undef T
+#undef NAME
+#define T double
+#define NAME(f) CAT(f, d, generic)
+#include "blas_kernel.h"
+#undef T
+#undef NAME
+#undef VB
+#undef TARGET
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define HAVE_X86 1
+
+#define TARGET __attribute__((target("avx2,fma")))
+#define VB 32
+#define T float
+#define NAME(f) CAT(f, s, avx2)
+#include "blas_kernel.h"
+#undef T
+#undef NAME
+#define T double
+#define NAME(f) CAT(f, d, avx2)
+#include "blas_kernel.h"
+#undef T
+#undef NAME
+#undef VB
+#undef TARGET
+
+#define TARGET __attribute__((target("avx512f,fma")))
+#define VB 64
+#define T float
+#define NAME(f) CAT(f, s, avx512)
+#include "blas_kernel.h"
+#undef T
+#undef NAME
+#define T double
+#define NAME(f) CAT(f, d, avx512)
+#include "blas_kernel.h"
+#undef T
+#undef NAME
+#undef VB
+#undef TARGET
+#endif
+
+/* ---------- dispatch ---------- */
+
+struct ops {
+  const char *name;
+  int (*usable)(void);
+  float (*sdot)(size_t, const float *, const float *);
+  double (*ddot)(size_t, const double *, const double *);
+  void (*saxpy)(size_t, float, const float *, float *);
+  void (*daxpy)(size_t, double, const double *, double *);
+  void (*sgemv)(size_t, size_t, const float *, size_t, const float *,
+                float, float, float *);
+  void (*dgemv)(size_t, size_t, const double *, size_t, const double *,
+                double, double, double *);
+  void (*sgemm)(size_t, size_t, size_t, size_t, float, const float *, size_t,
+                const float *, size_t, float, float *, size_t, float *, float *);
+  void (*dgemm)(size_t, size_t, size_t, size_t, double, const double *, size_t,
+                const double *, size_t, double, double *, size_t, double *, double *);
+};
+
+static int always(void) {return 1;}
+
+#define OPS(isa, usable) {#isa, usable, \
+  CAT(dot, s, isa), CAT(dot, d, isa), CAT(axpy, s, isa), CAT(axpy, d, isa), \
+  CAT(gemv, s, isa), CAT(gemv, d, isa), CAT(gemm, s, isa), CAT(gemm, d, isa)}
+
+#ifdef HAVE_X86
+static int has_avx2(void)
+{return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+}
+
+static int has_avx512(void)
+{return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("fma");
+}
+#endif
+
+/* the best first */
+static const struct ops all_ops[] = {
+#ifdef HAVE_X86
+  OPS(avx512, has_avx512),
+  OPS(avx2, has_avx2),
+#endif
+  OPS(generic, always)
+};
+#define NOPS (sizeof(all_ops) / sizeof(all_ops[0]))
+
+static const struct ops *ops;
+static pthread_once_t ops_once = PTHREAD_ONCE_INIT;
+
+static void pick_ops(void)
+{size_t i;
+#ifdef HAVE_X86
+ __builtin_cpu_init();
+#endif
+ for(i=0; !all_ops[i].usable(); i++) ;
+ ops = &all_ops[i];
+}
+
+#define OPS_READY() pthread_once(&ops_once, pick_ops)
+
+const char *blas_isa(void)
+{OPS_READY();
+ return ops->name;
+}
+
+int blas_use(const char *isa)
+{size_t i;
+ OPS_READY();
+ for(i=0; i<NOPS; i++)
+    if(strcmp(all_ops[i].name, isa) == 0 && all_ops[i].usable())
+      {ops = &all_ops[i];
+       return 0;
+      }
+ return -1;
+}
+
+/* ---------- vectors ---------- */
+
+float blas_sdot(size_t n, const float *x, const float *y)
+{OPS_READY();
+ return ops->sdot(n, x, y);
+}
+
+double blas_ddot(size_t n, const double *x, const double *y)
+{OPS_READY();
+ return ops->ddot(n, x, y);
+}
+
+void blas_saxpy(size_t n, float a, const float *x, float *y)
+{OPS_READY();
+ ops->saxpy(n, a, x, y);
+}
+
+void blas_daxpy(size_t n, double a, const double *x, double *y)
+{OPS_READY();
+ ops->daxpy(n, a, x, y);
+}
+
+int blas_sgemv(float alpha, const matrix *a, const float *x, float beta, float *y)
+{if(a->dtype != MATRIX_FLOAT) return -1;
+ OPS_READY();
+ ops->sgemv(a->rows, a->cols, a->data, a->stride, x, alpha, beta, y);
+ return 0;
+}
+
+int blas_dgemv(double alpha, const matrix *a, const double *x, double beta, double *y)
+{if(a->dtype != MATRIX_DOUBLE) return -1;
+ OPS_READY();
+ ops->dgemv(a->rows, a->cols, a->data, a->stride, x, alpha, beta, y);
+ return 0;
+}
+
+/* ---------- matrix product ---------- */
+
+/* the rows of C that one thread computes */
+struct slice {
+  const struct ops *ops;
+  double alpha, beta;
+  const matrix *a, *b;
+  matrix *c;
+  size_t i0, i1;
+  void *ap, *bp;   /* its packing buffers */
+  pthread_t tid;
+};
+
+static void *gemm_slice(void *arg)
+{struct slice *s = arg;
+ const matrix *a = s->a, *b = s->b;
+ matrix *c = s->c;
+ if(c->dtype == MATRIX_FLOAT)
+    s->ops->sgemm(s->i0, s->i1, c->cols, a->cols, (float)s->alpha,
+                  a->data, a->stride, b->data, b->stride,
+                  (float)s->beta, c->data, c->stride, s->ap, s->bp);
+ else
+    s->ops->dgemm(s->i0, s->i1, c->cols, a->cols, s->alpha,
+                  a->data, a->stride, b->data, b->stride,
+                  s->beta, c->data, c->stride, s->ap, s->bp);
+ return NULL;
+}
+
+int blas_gemm(double alpha, const matrix *a, const matrix *b, double beta,
+              matrix *c, int nthreads)
+{struct slice *s;
+ size_t es = matrix_elsize(c->dtype), rows;
+ int t, started, ret = 0;
+
+ if(a->dtype != c->dtype || b->dtype != c->dtype || es == 0
+    || a->rows != c->rows || b->cols != c->cols || a->cols != b->rows)
+   return -1;
+ OPS_READY();
+
+ if(nthreads <= 0) nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+ if(nthreads <= 0) nthreads = 1;
+ /* each thread takes rows of C, whole tiles of 6 rows, at least 8 of them */
+ if((size_t)nthreads > c->rows / 48 + 1) nthreads = (int)(c->rows / 48 + 1);
+ rows = (c->rows + nthreads - 1) / nthreads;
+ rows = (rows + 5) / 6 * 6;
+
+ s = calloc((size_t)nthreads, sizeof(struct slice));
+ if(s == NULL) return -1;
+ for(t=0; t<nthreads; t++)
+    {s[t].ops = ops;
+     s[t].alpha = alpha; s[t].beta = beta;
+     s[t].a = a; s[t].b = b; s[t].c = c;
+     s[t].i0 = t * rows < c->rows ? t * rows : c->rows;
+     s[t].i1 = (t + 1) * rows < c->rows ? (t + 1) * rows : c->rows;
+     if(posix_memalign(&s[t].ap, MATRIX_ALIGN, MC * KC * es) != 0
+        || posix_memalign(&s[t].bp, MATRIX_ALIGN, KC * NC * es) != 0)
+       {ret = -1;
+        break;
+       }
+    }
+ if(ret == 0)
+   {for(started=1; started<nthreads; started++)
+       if(pthread_create(&s[started].tid, NULL, gemm_slice, &s[started]) != 0)
+          break;
+    gemm_slice(&s[0]);
+    /* the slices of threads that could not be started */
+    for(t=started; t<nthreads; t++) gemm_slice(&s[t]);
+    for(t=1; t<started; t++) pthread_join(s[t].tid, NULL);
+   }
+ for(t=0; t<nthreads; t++)
+    {free(s[t].ap);
+     free(s[t].bp);
+    }
+ free(s);
+ return ret;
+}
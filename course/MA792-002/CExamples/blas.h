@@ -0,0 +1,49 @@
+/* File: CExamples/blas.h
+   BLAS style kernels for vectors and for the matrices of matrix.h:
+   dot product, axpy, matrix times vector and a cache blocked matrix
+   product on several threads, for float and for double.  Each kernel
+   is compiled for AVX-512, for AVX2 with FMA, and in a generic form;
+   the first call picks the best one the processor has.
+   Needs C99; link with blas.c, matrix.c and -pthread. */
+
+#ifndef BLAS_H
+#define BLAS_H
+
+#include <stddef.h> /* for size_t */
+#include "matrix.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* the kernels in use: "avx512", "avx2" or "generic" */
+const char *blas_isa(void);
+
+/* use the kernels named isa; return 0, or -1 if there are none by that
+   name or this processor cannot run them */
+int blas_use(const char *isa);
+
+/* x[0]*y[0] + ... + x[n-1]*y[n-1] */
+float  blas_sdot(size_t n, const float *x, const float *y);
+double blas_ddot(size_t n, const double *x, const double *y);
+
+/* y[i] += a * x[i] */
+void blas_saxpy(size_t n, float a, const float *x, float *y);
+void blas_daxpy(size_t n, double a, const double *x, double *y);
+
+/* y = alpha * A x + beta * y, x of a->cols and y of a->rows elements;
+   return 0, or -1 if A is of the other type */
+int blas_sgemv(float alpha, const matrix *a, const float *x, float beta, float *y);
+int blas_dgemv(double alpha, const matrix *a, const double *x, double beta, double *y);
+
+/* C = alpha * A B + beta * C for matrices of one type (C must not
+   overlap A or B), on nthreads threads (0 for one per processor);
+   return 0, or -1 if the shapes or types do not fit or out of memory */
+int blas_gemm(double alpha, const matrix *a, const matrix *b, double beta,
+              matrix *c, int nthreads);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BLAS_H */
@@ -0,0 +1,148 @@
+/* File: CExamples/blas_bench.c
+   Times the kernels of blas.c with each instruction set the processor
+   has, against plain loops, and checks the matrix products against the
+   triple loop.  Rates are in GFLOP/s (a multiply and an add are two).
+   Run as "blas_bench [n [threads]]" for n x n matrices (default 1024)
+   and vectors of n*n elements.
+   Compile as "gcc -Wall -std=c99 -O3 -ffp-contract=fast -pthread blas_bench.c blas.c matrix.c" */
+
+#define _POSIX_C_SOURCE 199309L /* for clock_gettime */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "blas.h"
+
+/* seconds since some fixed time */
+static double now(void)
+{struct timespec ts;
+ clock_gettime(CLOCK_MONOTONIC, &ts);
+ return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+/* run code, repeated until 0.3 s have passed, and print flops/time */
+#define RATE(code, flops) \
+  {double t0 = now(), t; long r = 0; \
+   do {code; r++;} while((t = now() - t0) < 0.3); \
+   printf(" %8.2f", (flops) * r / t * 1e-9); \
+   fflush(stdout); \
+  }
+
+/* C = A B by the triple loop over the rows of C, of A and of B */
+static void naive_gemm(const matrix *a, const matrix *b, matrix *c)
+{size_t i, j, k, n = a->cols;
+ for(i=0; i<c->rows; i++)
+    for(j=0; j<c->cols; j++)
+       {double s = 0;
+        if(c->dtype == MATRIX_FLOAT)
+          {for(k=0; k<n; k++) s += MATRIX_F(a, i, k) * MATRIX_F(b, k, j);
+           MATRIX_F(c, i, j) = (float)s;
+          }
+        else
+          {for(k=0; k<n; k++) s += MATRIX_D(a, i, k) * MATRIX_D(b, k, j);
+           MATRIX_D(c, i, j) = s;
+          }
+       }
+}
+
+/* largest difference of two matrices of one type */
+static double maxdiff(const matrix *x, const matrix *y)
+{size_t i, j;
+ double d, m = 0;
+ for(i=0; i<x->rows; i++)
+    for(j=0; j<x->cols; j++)
+       {d = x->dtype == MATRIX_FLOAT ? MATRIX_F(x, i, j) - MATRIX_F(y, i, j)
+                                     : MATRIX_D(x, i, j) - MATRIX_D(y, i, j);
+        if(fabs(d) > m) m = fabs(d);
+       }
+ return m;
+}
+
+static float sdot_loop(size_t n, const float *x, const float *y)
+{size_t i;
+ float s = 0;
+ for(i=0; i<n; i++) s += x[i] * y[i];
+ return s;
+}
+
+static double ddot_loop(size_t n, const double *x, const double *y)
+{size_t i;
+ double s = 0;
+ for(i=0; i<n; i++) s += x[i] * y[i];
+ return s;
+}
+
+int main(int argc, char **argv)
+{static const char *isa[] = {"generic", "avx2", "avx512"};
+ size_t n = 1024, nn, i, j;
+ int nthreads = 0, d, k;
+ matrix a[2], b[2], c[2], ref[2];
+ void *x[2], *y[2];
+ double t0, sink = 0;
+
+ if(argc > 1) n = (size_t)atol(argv[1]);
+ if(argc > 2) nthreads = atoi(argv[2]);
+ nn = n * n;
+ for(d=0; d<2; d++)
+    {int dt = d == 0 ? MATRIX_FLOAT : MATRIX_DOUBLE;
+     x[d] = calloc(nn, matrix_elsize(dt));
+     y[d] = calloc(nn, matrix_elsize(dt));
+     if(x[d] == NULL || y[d] == NULL
+        || matrix_alloc(&a[d], dt, n, n) != 0 || matrix_alloc(&b[d], dt, n, n) != 0
+        || matrix_alloc(&c[d], dt, n, n) != 0 || matrix_alloc(&ref[d], dt, n, n) != 0)
+       {fprintf(stderr, "Out of memory\n");
+        return 1;
+       }
+    }
+ srand(1);
+ for(i=0; i<n; i++)
+    for(j=0; j<n; j++)
+       {MATRIX_D(&a[1], i, j) = MATRIX_F(&a[0], i, j) = rand() / (RAND_MAX + 1.0f) - 0.5f;
+        MATRIX_D(&b[1], i, j) = MATRIX_F(&b[0], i, j) = rand() / (RAND_MAX + 1.0f) - 0.5f;
+       }
+ for(i=0; i<nn; i++)
+    {((double *)x[1])[i] = ((float *)x[0])[i] = (float)i / nn;
+     ((double *)y[1])[i] = ((float *)y[0])[i] = 1;
+    }
+
+ printf("n = %lu, GFLOP/s        float   double\n", (unsigned long)n);
+ for(d=0; d<2; d++)
+    {t0 = now();
+     naive_gemm(&a[d], &b[d], &ref[d]);
+     if(d == 0) printf("gemm, triple loop  ");
+     printf(" %8.2f", 2.0 * n * nn / (now() - t0) * 1e-9);
+    }
+ printf("\ndot, plain loop    ");
+ RATE(sink += sdot_loop(nn, x[0], y[0]), 2.0 * nn);
+ RATE(sink += ddot_loop(nn, x[1], y[1]), 2.0 * nn);
+ printf("\n");
+
+ for(k=0; k<3; k++)
+    {if(blas_use(isa[k]) != 0) continue;
+     printf("%s:\n  dot              ", isa[k]);
+     RATE(sink += blas_sdot(nn, x[0], y[0]), 2.0 * nn);
+     RATE(sink += blas_ddot(nn, x[1], y[1]), 2.0 * nn);
+     printf("\n  axpy             ");
+     RATE(blas_saxpy(nn, 1e-9f, x[0], y[0]), 2.0 * nn);
+     RATE(blas_daxpy(nn, 1e-9, x[1], y[1]), 2.0 * nn);
+     printf("\n  gemv             ");
+     RATE(blas_sgemv(1, &a[0], x[0], 0, y[0]), 2.0 * nn);
+     RATE(blas_dgemv(1, &a[1], x[1], 0, y[1]), 2.0 * nn);
+     printf("\n  gemm, 1 thread   ");
+     RATE(blas_gemm(1, &a[0], &b[0], 0, &c[0], 1), 2.0 * n * nn);
+     RATE(blas_gemm(1, &a[1], &b[1], 0, &c[1], 1), 2.0 * n * nn);
+     printf("\n  gemm, threads    ");
+     RATE(blas_gemm(1, &a[0], &b[0], 0, &c[0], nthreads), 2.0 * n * nn);
+     RATE(blas_gemm(1, &a[1], &b[1], 0, &c[1], nthreads), 2.0 * n * nn);
+     printf("\n  gemm error        %8.1e %8.1e\n",
+            maxdiff(&c[0], &ref[0]), maxdiff(&c[1], &ref[1]));
+    }
+ if(sink == 42) printf("\n"); /* keep the dot products */
+
+ for(d=0; d<2; d++)
+    {free(x[d]); free(y[d]);
+     matrix_free(&a[d]); matrix_free(&b[d]);
+     matrix_free(&c[d]); matrix_free(&ref[d]);
+    }
+ return 0;
+}
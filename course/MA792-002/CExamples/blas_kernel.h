@@ -0,0 +1,183 @@
+/* File: CExamples/blas_kernel.h
+   The kernels of blas.c for one element type and one instruction set;
+   blas.c includes this file once for each, after defining
+     T       the element type, float or double
+     NAME(f) the name of f for this type and instruction set
+     TARGET  the function attribute selecting the instruction set
+     VB      the bytes in a vector register
+   The code uses the vector types of GCC (and clang), which the compiler
+   maps to the registers of TARGET. */
+
+#define VL (VB / (int)sizeof(T)) /* elements per vector */
+#define MR 6                     /* rows of the C tile of the kernel */
+#define NR (2 * VL)              /* and its columns, two vectors */
+
+typedef T NAME(vec) __attribute__((vector_size(VB)));
+/* the same, for loads and stores at any element boundary */
+typedef T NAME(uvec) __attribute__((vector_size(VB), aligned(sizeof(T)), may_alias));
+
+TARGET static T NAME(sum)(NAME(vec) v)
+{T s = 0;
+ int i;
+ for(i=0; i<VL; i++) s += v[i];
+ return s;
+}
+
+TARGET static T NAME(dot)(size_t n, const T *x, const T *y)
+{NAME(vec) s0 = {0}, s1 = {0}, s2 = {0}, s3 = {0};
+ size_t i = 0;
+ T s;
+ /* four sums, to keep four additions in flight */
+ for(; i + 4 * VL <= n; i += 4 * VL)
+    {s0 += *(const NAME(uvec) *)(x + i) * *(const NAME(uvec) *)(y + i);
+     s1 += *(const NAME(uvec) *)(x + i + VL) * *(const NAME(uvec) *)(y + i + VL);
+     s2 += *(const NAME(uvec) *)(x + i + 2 * VL) * *(const NAME(uvec) *)(y + i + 2 * VL);
+     s3 += *(const NAME(uvec) *)(x + i + 3 * VL) * *(const NAME(uvec) *)(y + i + 3 * VL);
+    }
+ for(; i + VL <= n; i += VL)
+    s0 += *(const NAME(uvec) *)(x + i) * *(const NAME(uvec) *)(y + i);
+ s = NAME(sum)((s0 + s1) + (s2 + s3));
+ for(; i < n; i++) s += x[i] * y[i];
+ return s;
+}
+
+TARGET static void NAME(axpy)(size_t n, T a, const T *x, T *y)
+{size_t i = 0;
+ for(; i + 2 * VL <= n; i += 2 * VL)
+    {*(NAME(uvec) *)(y + i) += a * *(const NAME(uvec) *)(x + i);
+     *(NAME(uvec) *)(y + i + VL) += a * *(const NAME(uvec) *)(x + i + VL);
+    }
+ for(; i < n; i++) y[i] += a * x[i];
+}
+
+/* y = alpha A x + beta y for A of rows x cols with the given stride;
+   four rows at a time, so that each load of x serves four of them */
+TARGET static void NAME(gemv)(size_t rows, size_t cols, const T *a, size_t stride,
+                              const T *x, T alpha, T beta, T *y)
+{size_t i, j;
+ T s[4];
+ int r;
+ for(i=0; i + 4 <= rows; i += 4)
+    {const T *a0 = a + i * stride, *a1 = a0 + stride, *a2 = a1 + stride, *a3 = a2 + stride;
+     NAME(vec) s0 = {0}, s1 = {0}, s2 = {0}, s3 = {0}, xv;
+     for(j=0; j + VL <= cols; j += VL)
+        {xv = *(const NAME(uvec) *)(x + j);
+         s0 += *(const NAME(uvec) *)(a0 + j) * xv;
+         s1 += *(const NAME(uvec) *)(a1 + j) * xv;
+         s2 += *(const NAME(uvec) *)(a2 + j) * xv;
+         s3 += *(const NAME(uvec) *)(a3 + j) * xv;
+        }
+     s[0] = NAME(sum)(s0); s[1] = NAME(sum)(s1);
+     s[2] = NAME(sum)(s2); s[3] = NAME(sum)(s3);
+     for(; j < cols; j++)
+        {s[0] += a0[j] * x[j]; s[1] += a1[j] * x[j];
+         s[2] += a2[j] * x[j]; s[3] += a3[j] * x[j];
+        }
+     for(r=0; r<4; r++)
+        y[i+r] = beta == 0 ? alpha * s[r] : alpha * s[r] + beta * y[i+r];
+    }
+ for(; i < rows; i++)
+    {s[0] = NAME(dot)(cols, a + i * stride, x);
+     y[i] = beta == 0 ? alpha * s[0] : alpha * s[0] + beta * y[i];
+    }
+}
+
+/* C[0..mr)[0..nr) += the product of an MR x kc panel of A (packed
+   column by column) and a kc x NR panel of B (packed row by row); the
+   MR x NR sums stay in registers for the whole of kc */
+TARGET static void NAME(kernel)(size_t kc, const T *ap, const T *bp,
+                                T *c, size_t ldc, size_t mr, size_t nr)
+{NAME(vec) c00 = {0}, c01 = {0}, c10 = {0}, c11 = {0}, c20 = {0}, c21 = {0},
+           c30 = {0}, c31 = {0}, c40 = {0}, c41 = {0}, c50 = {0}, c51 = {0};
+ NAME(vec) b0, b1;
+ T t[MR * NR];
+ size_t k, i, j;
+
+ for(k=0; k<kc; k++)
+    {b0 = *(const NAME(vec) *)bp;
+     b1 = *(const NAME(vec) *)(bp + VL);
+     c00 += ap[0] * b0; c01 += ap[0] * b1;
+     c10 += ap[1] * b0; c11 += ap[1] * b1;
+     c20 += ap[2] * b0; c21 += ap[2] * b1;
+     c30 += ap[3] * b0; c31 += ap[3] * b1;
+     c40 += ap[4] * b0; c41 += ap[4] * b1;
+     c50 += ap[5] * b0; c51 += ap[5] * b1;
+     ap += MR;
+     bp += NR;
+    }
+ if(mr == MR && nr == NR)
+   {
+#define ROW(r, v0, v1) \
+    *(NAME(uvec) *)(c + r * ldc) += v0; *(NAME(uvec) *)(c + r * ldc + VL) += v1;
+    ROW(0, c00, c01) ROW(1, c10, c11) ROW(2, c20, c21)
+    ROW(3, c30, c31) ROW(4, c40, c41) ROW(5, c50, c51)
+#undef ROW
+    return;
+   }
+ /* a tile at the edge of C */
+ *(NAME(uvec) *)(t + 0 * NR) = c00; *(NAME(uvec) *)(t + 0 * NR + VL) = c01;
+ *(NAME(uvec) *)(t + 1 * NR) = c10; *(NAME(uvec) *)(t + 1 * NR + VL) = c11;
+ *(NAME(uvec) *)(t + 2 * NR) = c20; *(NAME(uvec) *)(t + 2 * NR + VL) = c21;
+ *(NAME(uvec) *)(t + 3 * NR) = c30; *(NAME(uvec) *)(t + 3 * NR + VL) = c31;
+ *(NAME(uvec) *)(t + 4 * NR) = c40; *(NAME(uvec) *)(t + 4 * NR + VL) = c41;
+ *(NAME(uvec) *)(t + 5 * NR) = c50; *(NAME(uvec) *)(t + 5 * NR + VL) = c51;
+ for(i=0; i<mr; i++)
+    for(j=0; j<nr; j++) c[i * ldc + j] += t[i * NR + j];
+}
+
+/* rows [i0,i1) of C = alpha A B + beta C, blocked as in K. Goto and
+   R. van de Geijn, "Anatomy of high-performance matrix multiplication"
+   (2008): a KC x NC block of B and an MC x KC block of A are copied
+   into panels that the kernel reads in order, the first to stay in the
+   L3 (or L2) cache, the second in the L2 cache.  ap and bp have room
+   for MC x KC and KC x NC elements. */
+TARGET static void NAME(gemm)(size_t i0, size_t i1, size_t n, size_t kk,
+                              T alpha, const T *a, size_t lda,
+                              const T *b, size_t ldb,
+                              T beta, T *c, size_t ldc, T *ap, T *bp)
+{size_t jc, pc, ic, jr, ir, i, j, k, r, nc, kc, mc, mr, nr;
+ T *q;
+
+ for(i=i0; i<i1; i++)
+    if(beta == 0) for(j=0; j<n; j++) c[i * ldc + j] = 0;
+    else if(beta != 1) for(j=0; j<n; j++) c[i * ldc + j] *= beta;
+
+ for(jc=0; jc<n; jc+=NC)
+    {nc = n - jc < NC ? n - jc : NC;
+     for(pc=0; pc<kk; pc+=KC)
+        {kc = kk - pc < KC ? kk - pc : KC;
+         /* B[pc..pc+kc)[jc..jc+nc) in panels of NR columns */
+         for(jr=0, q=bp; jr<nc; jr+=NR)
+            {nr = nc - jr < NR ? nc - jr : NR;
+             for(k=0; k<kc; k++, q+=NR)
+                {const T *brow = b + (pc + k) * ldb + jc + jr;
+                 for(j=0; j<nr; j++) q[j] = brow[j];
+                 for(; j<NR; j++) q[j] = 0;
+                }
+            }
+         for(ic=i0; ic<i1; ic+=MC)
+            {mc = i1 - ic < MC ? i1 - ic : MC;
+             /* alpha A[ic..ic+mc)[pc..pc+kc) in panels of MR rows */
+             for(ir=0, q=ap; ir<mc; ir+=MR)
+                {mr = mc - ir < MR ? mc - ir : MR;
+                 for(k=0; k<kc; k++, q+=MR)
+                    {for(r=0; r<mr; r++) q[r] = alpha * a[(ic + ir + r) * lda + pc + k];
+                     for(; r<MR; r++) q[r] = 0;
+                    }
+                }
+             for(jr=0; jr<nc; jr+=NR)
+                {nr = nc - jr < NR ? nc - jr : NR;
+                 for(ir=0; ir<mc; ir+=MR)
+                    {mr = mc - ir < MR ? mc - ir : MR;
+                     NAME(kernel)(kc, ap + ir * kc, bp + jr * kc,
+                                  c + (ic + ir) * ldc + jc + jr, ldc, mr, nr);
+                    }
+                }
+            }
+        }
+    }
+}
+
+#undef VL
+#undef MR
+#undef NR
@@ -0,0 +1,733 @@
+/* File: CExamples/first_pgm_server.c
+   first_pgm_cgi.c and first_pgm_cgi_get.c as one long-running HTTP/1.1
+   server, so that a request no longer costs the fork and exec of a CGI
+   program: a POST with "c=%d" as its body is answered as first_pgm_cgi
+   answers it, and a GET (or HEAD) with "c=%d" as its query string as
+   first_pgm_cgi_get does, with the same text/plain body of c lines
+   "%3d. I've been bad.\n" (the path is not looked at).
+   A worker serves all its connections with one epoll loop on
+   non-blocking sockets. Connections are kept alive (HTTP/1.1, or
+   HTTP/1.0 with "Connection: keep-alive"), and pipelined requests are
+   answered in turn, several to a write. The body is made as the socket
+   takes it, a buffer at a time, so a huge c costs no more memory than a
+   small one; its length is known beforehand and sent as Content-Length.
+   The body for c is the start of the body for any larger c, so rather
+   than keep an answer for each c, the server makes the body for the
+   largest c that fits in -m bytes (16M by default) once, before it
+   forks, in a memfd that all workers share. Every body up to that c is
+   then a slice of it, sent without being made or copied: with the head
+   by writev, or by sendfile, and a small one copied next to its head so
+   that pipelined answers still go several to a write. A larger body
+   starts with all of it, and only the rest is made. The memory the
+   server takes is so bounded by -m and a fixed buffer per connection,
+   however large c is.
+   The server pre-forks -w workers (default 1; 0 to serve in the one
+   process) that share the listening socket, EPOLLEXCLUSIVE waking one
+   of them for a new connection. With -r, each worker has a socket of
+   its own instead, bound to the same port with SO_REUSEPORT, so that
+   the kernel spreads the connections over them without the workers
+   contending for one queue; the workers are then one per core (unless
+   -w says otherwise) and each is kept on its own core. The parent
+   restarts a worker that dies, and stops them all on SIGTERM or SIGINT.
+   A connection idle for -k seconds (default 15) is closed.
+   Run as "first_pgm_server [-a address] [-p port] [-r] [-w workers] [-m bytes] [-k seconds]"
+   (127.0.0.1 and 8080 by default), or with "-u path" to listen on a
+   Unix domain socket instead (without -r), and try as
+     "curl -d c=3 http://127.0.0.1:8080/cgi-bin/first_pgm_cgi"
+     "curl 'http://127.0.0.1:8080/cgi-bin/first_pgm_cgi_get?c=3'"
+   Linux only. Compile as "gcc -Wall -std=gnu99 -O2 -o first_pgm_server first_pgm_server.c" */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+#include <sched.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#define INBUF 8192    /* the most a request, head and body, may take */
+#define OUTBUF 16384  /* the output buffer of a connection */
+#define MAXLINE 32    /* the longest line of a body, and more */
+#define MAXHEAD 512   /* the longest head of a response, and more */
+#define MAXEVENTS 256
+#define COPYMAX 4096  /* a cached body up to this is copied into out */
+#define SENDMAX (1 << 20) /* the most of a cached body sent at a time */
+
+/* what follows the number in each line of the body */
+static const char line_text[] = ". I've been bad.\n";
+#define LINE_TEXT (sizeof line_text - 1)
+
+/* ---------- the body ---------- */
+
+/* line i of the body, as printf("%3d. I've been bad.\n", i) makes it,
+   at p; return its length */
+static size_t put_line(char *p, long long i)
+{char d[24];
+ int n = 0, k = 0;
+ do {d[n++] = (char)('0' + i % 10);
+     i /= 10;
+    } while(i > 0);
+ while(n + k < 3) p[k++] = ' '; /* right aligned in 3 */
+ while(n > 0) p[k++] = d[--n];
+ memcpy(p + k, line_text, LINE_TEXT);
+ return k + LINE_TEXT;
+}
+
+/* the length of the body of c lines: the numbers of d digits take
+   max(d, 3) bytes each */
+static unsigned long long body_length(long long c)
+{unsigned long long n = 0;
+ long long lo = 1, hi = 9;
+ int d;
+ for(d = 1; lo <= c; d++, lo *= 10, hi = 10 * hi + 9)
+    n += (unsigned long long)((c < hi ? c : hi) - lo + 1) * ((d < 3 ? 3 : d) + LINE_TEXT);
+ return n;
+}
+
+/* the body for cache_lines lines, cache_len bytes, mapped from the
+   memfd cache_fd */
+static const char *cache;
+static size_t cache_len;
+static long long cache_lines;
+static int cache_fd = -1;
+
+/* make the cache, of the most lines that fit in max bytes; return 0, or
+   -1 with errno set */
+static int make_cache(size_t max)
+{char *p;
+ size_t len = 0, k;
+ long long i;
+ for(i = 1; len + 3 + LINE_TEXT <= max; i++)
+    {k = body_length(i) - body_length(i - 1);
+     if(len + k > max) break;
+     len += k;
+    }
+ cache_lines = i - 1;
+ cache_len = len;
+ if(len == 0) return 0;
+ cache_fd = memfd_create("first_pgm_body", MFD_CLOEXEC);
+ if(cache_fd < 0 || ftruncate(cache_fd, len) < 0) return -1;
+ p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, cache_fd, 0);
+ if(p == MAP_FAILED) return -1;
+ for(i = 1, k = 0; i <= cache_lines; i++) k += put_line(p + k, i);
+ mprotect(p, len, PROT_READ);
+ cache = p;
+ return 0;
+}
+
+/* ---------- requests ---------- */
+
+enum {GET, HEAD, POST};
+
+struct request
+{int method;
+ int http10;        /* an HTTP/1.0 request */
+ int keep;          /* keep the connection after the answer */
+ int status;        /* 0, or the HTTP status of an error */
+ const char *query; /* the query string, without the '?' */
+ size_t qlen;
+ const char *body;
+ size_t blen;
+};
+
+static int is_blank(char c)
+{return c == ' ' || c == '\t';
+}
+
+/* s[0..n) equal to the lower case name, ignoring case */
+static int same(const char *s, size_t n, const char *name)
+{return n == strlen(name) && strncasecmp(s, name, n) == 0;
+}
+
+/* the comma separated value v[0..n) has the token tok */
+static int has_token(const char *v, size_t n, const char *tok)
+{const char *end = v + n, *e;
+ while(v < end)
+   {while(v < end && (is_blank(*v) || *v == ',')) v++;
+    for(e = v; e < end && *e != ','; e++);
+    n = e - v;
+    while(n > 0 && is_blank(v[n-1])) n--;
+    if(same(v, n, tok)) return 1;
+    v = e;
+   }
+ return 0;
+}
+
+/* the request at in[0..len) into r; return its length, head and body,
+   or 0 if it has not all come yet. A bad request has r->status set and
+   takes all of in. */
+static size_t parse_request(const char *in, size_t len, struct request *r)
+{const char *end = in + len, *p, *eol, *head_end = NULL, *line, *sp, *target, *colon;
+ size_t n, head;
+ unsigned long long clen = 0;
+ int have_len = 0;
+
+ /* empty lines before a request are skipped, as some clients send an
+    extra CRLF after a body */
+ if(len > 0 && (in[0] == '\r' || in[0] == '\n'))
+   {n = 1;
+    while(n < len && (in[n] == '\r' || in[n] == '\n')) n++;
+    head = parse_request(in + n, len - n, r);
+    return head == 0 ? 0 : n + head;
+   }
+ memset(r, 0, sizeof *r);
+ /* the head ends with an empty line */
+ for(p = in; p < end && (eol = memchr(p, '\n', end - p)) != NULL; p = eol + 1)
+    if(eol + 1 < end && (eol[1] == '\n' || (eol[1] == '\r' && eol + 2 < end && eol[2] == '\n')))
+      {head_end = eol + (eol[1] == '\n' ? 2 : 3);
+       break;
+      }
+ if(head_end == NULL)
+   {if(len < INBUF) return 0;
+    r->status = 431;
+    return len;
+   }
+ r->status = 400;
+
+ /* the request line: method, target and version */
+ eol = memchr(in, '\n', head_end - in);
+ n = eol - in;
+ if(n > 0 && in[n-1] == '\r') n--;
+ sp = memchr(in, ' ', n);
+ if(sp == NULL) return len;
+ target = sp + 1;
+ line = memchr(target, ' ', in + n - target);
+ if(line == NULL || in + n - (line + 1) != 8 || memcmp(line + 1, "HTTP/1.", 7) != 0)
+   return len;
+ if(line[8] == '0') r->http10 = 1;
+ else if(line[8] != '1') return len;
+ r->keep = !r->http10;
+ p = memchr(target, '?', line - target);
+ if(p != NULL)
+   {r->query = p + 1;
+    r->qlen = line - (p + 1);
+   }
+ n = sp - in; /* methods are case-sensitive */
+ if(n == 3 && memcmp(in, "GET", 3) == 0) r->method = GET;
+ else if(n == 4 && memcmp(in, "HEAD", 4) == 0) r->method = HEAD;
+ else if(n == 4 && memcmp(in, "POST", 4) == 0) r->method = POST;
+ else {r->status = 405; return len;}
+
+ /* the header lines that matter */
+ for(p = eol + 1; p < head_end; p = eol + 1)
+    {eol = memchr(p, '\n', head_end - p);
+     n = eol - p;
+     if(n > 0 && p[n-1] == '\r') n--;
+     if(n == 0) break;
+     colon = memchr(p, ':', n);
+     if(colon == NULL) return len;
+     line = colon + 1;
+     while(line < p + n && is_blank(*line)) line++;
+     n = p + n - line;
+     while(n > 0 && is_blank(line[n-1])) n--;
+     if(same(p, colon - p, "content-length"))
+       {unsigned long long v = 0;
+        size_t i;
+        if(n == 0 || n > 18) return len;
+        for(i = 0; i < n; i++)
+           {if(line[i] < '0' || line[i] > '9') return len;
+            v = 10 * v + (line[i] - '0');
+           }
+        if(have_len && v != clen) return len;
+        clen = v;
+        have_len = 1;
+       }
+     else if(same(p, colon - p, "transfer-encoding"))
+       {r->status = 501; /* no chunked bodies */
+        return len;
+       }
+     else if(same(p, colon - p, "connection"))
+       {if(has_token(line, n, "close")) r->keep = 0;
+        else if(has_token(line, n, "keep-alive")) r->keep = 1;
+       }
+    }
+
+ head = head_end - in;
+ if(clen > INBUF - head)
+   {r->status = 413;
+    return len;
+   }
+ if(head + clen > len) return 0;
+ r->body = head_end;
+ r->blen = clen;
+ r->status = 0;
+ return head + clen;
+}
+
+/* ---------- connections ---------- */
+
+struct conn
+{int fd;
+ unsigned events;        /* what epoll waits for on it */
+ int keep;               /* more requests to come after the current one */
+ int draining;           /* all sent and shut down for writing; reading to the end */
+ time_t last;            /* when it last made progress */
+ size_t inlen;           /* the bytes in in */
+ size_t outlen, outoff;  /* the bytes in out, and how many of them are sent */
+ size_t coff, cend;      /* cache[coff..cend) is to be sent after out, */
+ long long next, lines;  /* and then lines next..lines are to be made */
+ char in[INBUF];
+ char out[OUTBUF];
+};
+
+static time_t now;
+static char date[64]; /* the Date header line for now */
+
+static void set_date(void)
+{struct tm tm;
+ gmtime_r(&now, &tm);
+ strftime(date, sizeof date, "Date: %a, %d %b %Y %H:%M:%S GMT\r\n", &tm);
+}
+
+static const char *reason(int status)
+{switch(status){
+ case 400: return "Bad Request";
+ case 405: return "Method Not Allowed";
+ case 413: return "Content Too Large";
+ case 431: return "Request Header Fields Too Large";
+ default: return "Not Implemented";
+ }
+}
+
+/* the head of the answer to r at the end of c->out, with the lines of
+   its body to come */
+static void respond(struct conn *c, const struct request *r)
+{char arg[INBUF + 1];
+ const char *s;
+ size_t n;
+ int lines = 0;
+
+ c->keep = r->keep;
+ c->coff = c->cend = 0;
+ c->next = 1;
+ c->lines = 0;
+ if(r->status)
+   {c->keep = 0;
+    c->outlen += sprintf(c->out + c->outlen,
+                         "HTTP/1.1 %d %s\r\n%s%sContent-Type: text/plain\r\n"
+                         "Content-Length: %zu\r\nConnection: close\r\n\r\n%s\n",
+                         r->status, reason(r->status), date,
+                         r->status == 405 ? "Allow: GET, HEAD, POST\r\n" : "",
+                         strlen(reason(r->status)) + 1, reason(r->status));
+    return;
+   }
+ /* c as the CGI programs read it, from the body or the query string;
+    none (where they would go on with c undefined) is 0 */
+ s = r->method == POST ? r->body : r->query;
+ n = r->method == POST ? r->blen : r->qlen;
+ if(s != NULL) memcpy(arg, s, n);
+ else n = 0;
+ arg[n] = '\0';
+ if(sscanf(arg, "c=%d", &lines) != 1) lines = 0;
+
+ c->outlen += sprintf(c->out + c->outlen,
+                      "HTTP/1.1 200 OK\r\n%sContent-Type: text/plain\r\n"
+                      "Content-Length: %llu\r\n%s\r\n",
+                      date, body_length(lines),
+                      !c->keep ? "Connection: close\r\n"
+                      : r->http10 ? "Connection: keep-alive\r\n" : "");
+ if(r->method == HEAD || lines <= 0) return;
+ c->lines = lines;
+ if(lines <= cache_lines)
+   {c->cend = body_length(lines);
+    c->next = lines + 1;
+   }
+ else
+   {c->cend = cache_len;
+    c->next = cache_lines + 1;
+   }
+}
+
+/* wait for events on c, if not already */
+static int want(struct conn *c, int efd, unsigned events)
+{struct epoll_event ev;
+ if(c->events == events) return 0;
+ ev.events = events;
+ ev.data.ptr = c;
+ if(epoll_ctl(efd, EPOLL_CTL_MOD, c->fd, &ev) < 0) return -1;
+ c->events = events;
+ return 0;
+}
+
+/* make what progress c can: answer the requests that have come, send,
+   and read more; return -1 when it is to be closed */
+static int serve(struct conn *c, int efd)
+{struct request r;
+ struct iovec iov[2];
+ size_t n;
+ ssize_t got;
+ off_t off;
+
+ for(;;)
+    {/* fill out with the rest of the body, then with the answers to
+        the requests already read; a cached body that is not small is
+        sent from the cache, after out */
+     for(;;)
+        {if(c->coff < c->cend)
+           {n = c->cend - c->coff;
+            if(n > COPYMAX || n > OUTBUF - c->outlen) break;
+            memcpy(c->out + c->outlen, cache + c->coff, n);
+            c->outlen += n;
+            c->coff = c->cend;
+           }
+         while(c->next <= c->lines && OUTBUF - c->outlen >= MAXLINE)
+            c->outlen += put_line(c->out + c->outlen, c->next++);
+         if(c->next <= c->lines || !c->keep || OUTBUF - c->outlen < MAXHEAD) break;
+         n = parse_request(c->in, c->inlen, &r);
+         if(n == 0) break;
+         respond(c, &r);
+         c->inlen -= n;
+         memmove(c->in, c->in + n, c->inlen);
+        }
+
+     if(c->outoff < c->outlen)
+       {/* out, and the cached body after it in the same call */
+        iov[0].iov_base = c->out + c->outoff;
+        iov[0].iov_len = c->outlen - c->outoff;
+        iov[1].iov_base = (char *)cache + c->coff;
+        iov[1].iov_len = c->cend - c->coff < SENDMAX ? c->cend - c->coff : SENDMAX;
+        got = iov[1].iov_len ? writev(c->fd, iov, 2) : write(c->fd, iov[0].iov_base, iov[0].iov_len);
+        if(got < 0)
+          {if(errno == EINTR) continue;
+           if(errno == EAGAIN) return want(c, efd, EPOLLOUT);
+           return -1;
+          }
+        c->last = now;
+        if((size_t)got > iov[0].iov_len)
+          {c->coff += got - iov[0].iov_len;
+           got = iov[0].iov_len;
+          }
+        c->outoff += got;
+        if(c->outoff == c->outlen) c->outoff = c->outlen = 0;
+        else if(c->outoff > OUTBUF / 2)
+          {memmove(c->out, c->out + c->outoff, c->outlen - c->outoff);
+           c->outlen -= c->outoff;
+           c->outoff = 0;
+          }
+        continue;
+       }
+
+     if(c->coff < c->cend)
+       {/* the cached body alone, from the page cache */
+        off = c->coff;
+        got = sendfile(c->fd, cache_fd, &off, c->cend - c->coff < SENDMAX ? c->cend - c->coff : SENDMAX);
+        if(got < 0)
+          {if(errno == EINTR) continue;
+           if(errno == EAGAIN) return want(c, efd, EPOLLOUT);
+           return -1;
+          }
+        c->last = now;
+        c->coff += got;
+        continue;
+       }
+
+     /* all sent: read the next request, or close. Closing at once with
+        a request unread would make the kernel reset the connection, and
+        the client could lose the answer (a 413, say), so the socket is
+        shut down for writing and read to its end first. */
+     if(!c->keep && !c->draining)
+       {if(shutdown(c->fd, SHUT_WR) < 0) return -1;
+        c->draining = 1;
+       }
+     if(c->draining) c->inlen = 0;
+     got = read(c->fd, c->in + c->inlen, INBUF - c->inlen);
+     if(got < 0)
+       {if(errno == EINTR) continue;
+        if(errno == EAGAIN) return want(c, efd, EPOLLIN);
+        return -1;
+       }
+     if(got == 0) return -1;
+     c->last = now;
+     c->inlen += got;
+    }
+}
+
+/* ---------- a worker ---------- */
+
+static struct conn **conns; /* by file descriptor */
+static int nconns;
+
+static void close_conn(struct conn *c)
+{conns[c->fd] = NULL;
+ close(c->fd);
+ free(c);
+}
+
+static void accept_all(int lfd, int efd)
+{struct epoll_event ev;
+ struct conn *c, **nc;
+ int fd, one = 1;
+
+ while((fd = accept4(lfd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0)
+    {setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one); /* fails on a Unix socket */
+     if(fd >= nconns)
+       {int n = fd < 2 * nconns ? 2 * nconns : fd + 64;
+        nc = realloc(conns, n * sizeof *conns);
+        if(nc == NULL) {close(fd); continue;}
+        memset(nc + nconns, 0, (n - nconns) * sizeof *conns);
+        conns = nc;
+        nconns = n;
+       }
+     c = malloc(sizeof *c);
+     if(c == NULL) {close(fd); continue;}
+     c->fd = fd;
+     c->events = EPOLLIN;
+     c->keep = 1;
+     c->draining = 0;
+     c->last = now;
+     c->inlen = c->outlen = c->outoff = 0;
+     c->coff = c->cend = 0;
+     c->next = 1;
+     c->lines = 0;
+     ev.events = EPOLLIN;
+     ev.data.ptr = c;
+     if(epoll_ctl(efd, EPOLL_CTL_ADD, fd, &ev) < 0)
+       {close(fd);
+        free(c);
+        continue;
+       }
+     conns[fd] = c;
+    }
+ /* EAGAIN: none left; EMFILE and the like: try again on the next event */
+}
+
+static void worker(int lfd, int idle)
+{struct epoll_event ev, evs[MAXEVENTS];
+ time_t swept;
+ int efd, i, n;
+
+ efd = epoll_create1(EPOLL_CLOEXEC);
+ ev.events = EPOLLIN | EPOLLEXCLUSIVE;
+ ev.data.ptr = NULL;
+ if(efd < 0 || epoll_ctl(efd, EPOLL_CTL_ADD, lfd, &ev) < 0)
+   {perror("epoll");
+    exit(1);
+   }
+ swept = now = time(NULL);
+ set_date();
+ for(;;)
+    {n = epoll_wait(efd, evs, MAXEVENTS, 1000);
+     if(n < 0 && errno != EINTR)
+       {perror("epoll_wait");
+        exit(1);
+       }
+     now = time(NULL);
+     if(now != swept) set_date();
+     for(i = 0; i < n; i++)
+        if(evs[i].data.ptr == NULL) accept_all(lfd, efd);
+        else if(serve(evs[i].data.ptr, efd) < 0) close_conn(evs[i].data.ptr);
+     /* once a second, close the connections idle too long */
+     if(now != swept)
+       {for(i = 0; i < nconns; i++)
+           if(conns[i] != NULL && now - conns[i]->last > idle) close_conn(conns[i]);
+        swept = now;
+       }
+    }
+}
+
+/* ---------- the listening socket and the workers ---------- */
+
+/* a listening socket on addr and port, or on the Unix socket path; with
+   reuse, one of several on the same port (SO_REUSEPORT) */
+static int listen_on(const char *addr, const char *port, const char *path, int reuse)
+{struct addrinfo hints, *res, *a;
+ int fd = -1, one = 1, err;
+
+ if(path != NULL)
+   {struct sockaddr_un un;
+    memset(&un, 0, sizeof un);
+    un.sun_family = AF_UNIX;
+    if(strlen(path) >= sizeof un.sun_path)
+      {fprintf(stderr, "%s: name too long\n", path);
+       return -1;
+      }
+    strcpy(un.sun_path, path);
+    unlink(path);
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(fd < 0 || bind(fd, (struct sockaddr *)&un, sizeof un) < 0 || listen(fd, SOMAXCONN) < 0)
+      {perror(path);
+       return -1;
+      }
+    return fd;
+   }
+
+ memset(&hints, 0, sizeof hints);
+ hints.ai_family = AF_UNSPEC;
+ hints.ai_socktype = SOCK_STREAM;
+ hints.ai_flags = AI_PASSIVE;
+ if((err = getaddrinfo(addr, port, &hints, &res)) != 0)
+   {fprintf(stderr, "%s:%s: %s\n", addr, port, gai_strerror(err));
+    return -1;
+   }
+ for(a = res; a != NULL; a = a->ai_next)
+    {fd = socket(a->ai_family, a->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, a->ai_protocol);
+     if(fd < 0) continue;
+     setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof one);
+     if(reuse && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof one) < 0)
+       {close(fd);
+        fd = -1;
+        break;
+       }
+     if(bind(fd, a->ai_addr, a->ai_addrlen) == 0 && listen(fd, SOMAXCONN) == 0) break;
+     close(fd);
+     fd = -1;
+    }
+ if(fd < 0) perror(addr);
+ freeaddrinfo(res);
+ return fd;
+}
+
+static volatile sig_atomic_t stop;
+
+static void on_signal(int sig)
+{if(sig != SIGCHLD) stop = 1;
+}
+
+/* keep the calling process on the k-th of the cores it may run on */
+static void pin(int k)
+{cpu_set_t all, one;
+ int cpu, n = 0, count;
+ if(sched_getaffinity(0, sizeof all, &all) < 0) return;
+ count = CPU_COUNT(&all);
+ for(cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    if(CPU_ISSET(cpu, &all) && n++ == k % count)
+      {CPU_ZERO(&one);
+       CPU_SET(cpu, &one);
+       sched_setaffinity(0, sizeof one, &one);
+       return;
+      }
+}
+
+/* fork worker k, on lfd[k] of nsock sockets (lfd[0] if there is one) */
+static pid_t start_worker(const int *lfd, int nsock, int k, int idle, const sigset_t *mask)
+{pid_t pid = fork();
+ int i;
+ if(pid == 0)
+   {signal(SIGTERM, SIG_DFL);
+    signal(SIGINT, SIG_DFL);
+    signal(SIGCHLD, SIG_DFL);
+    sigprocmask(SIG_SETMASK, mask, NULL);
+    if(nsock > 1)
+      {for(i = 0; i < nsock; i++) if(i != k) close(lfd[i]);
+       pin(k);
+      }
+    worker(lfd[nsock > 1 ? k : 0], idle);
+   }
+ if(pid < 0) perror("fork");
+ return pid;
+}
+
+static void usage(const char *prog)
+{fprintf(stderr, "usage: %s [-a address] [-p port | -u path] [-r] [-w workers] [-m bytes]"
+                 " [-k seconds]\n", prog);
+}
+
+int main(int argc, char **argv)
+{const char *addr = "127.0.0.1", *port = "8080", *path = NULL;
+ int opt, *lfd, nsock, i, workers = -1, idle = 15, reuse = 0, status;
+ double cache_size = 16 << 20;
+ char *end;
+ struct sigaction sa;
+ sigset_t block, mask;
+ pid_t *pid, p;
+ time_t *started;
+
+ while((opt = getopt(argc, argv, "a:p:u:rw:m:k:")) != -1)
+    switch(opt){
+    case 'a': addr = optarg; break;
+    case 'p': port = optarg; break;
+    case 'u': path = optarg; break;
+    case 'r': reuse = 1; break;
+    case 'w': workers = atoi(optarg); break;
+    case 'm':
+      cache_size = strtod(optarg, &end);
+      if(*end == 'k' || *end == 'K') cache_size *= 1 << 10;
+      else if(*end == 'm' || *end == 'M') cache_size *= 1 << 20;
+      else if(*end == 'g' || *end == 'G') cache_size *= 1 << 30;
+      break;
+    case 'k': idle = atoi(optarg); break;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+ if(optind != argc || workers < -1 || idle < 1 || cache_size < 0 || (reuse && path != NULL))
+   {usage(argv[0]);
+    return 1;
+   }
+ if(workers == -1) workers = reuse ? (int)sysconf(_SC_NPROCESSORS_ONLN) : 1;
+ if(workers < 1 && reuse) workers = 1;
+ signal(SIGPIPE, SIG_IGN);
+ if(make_cache((size_t)cache_size) < 0)
+   {perror("cache");
+    return 1;
+   }
+
+ /* with -r, a socket for each worker, made here so that one that
+    restarts finds the connections queued for it */
+ nsock = reuse ? workers : 1;
+ lfd = calloc(nsock, sizeof *lfd);
+ if(lfd == NULL)
+   {fprintf(stderr, "Out of memory\n");
+    return 1;
+   }
+ for(i = 0; i < nsock; i++)
+    if((lfd[i] = listen_on(addr, port, path, reuse)) < 0) return 1;
+ if(workers == 0) worker(lfd[0], idle);
+
+ /* the parent: signals are taken only in sigsuspend, so none is lost
+    between looking at stop and waiting */
+ memset(&sa, 0, sizeof sa);
+ sa.sa_handler = on_signal;
+ sigaction(SIGTERM, &sa, NULL);
+ sigaction(SIGINT, &sa, NULL);
+ sigaction(SIGCHLD, &sa, NULL);
+ sigemptyset(&block);
+ sigaddset(&block, SIGTERM);
+ sigaddset(&block, SIGINT);
+ sigaddset(&block, SIGCHLD);
+ sigprocmask(SIG_BLOCK, &block, &mask);
+
+ pid = calloc(workers, sizeof *pid);
+ started = calloc(workers, sizeof *started);
+ if(pid == NULL || started == NULL)
+   {fprintf(stderr, "Out of memory\n");
+    return 1;
+   }
+ for(i = 0; i < workers; i++)
+    {pid[i] = start_worker(lfd, nsock, i, idle, &mask);
+     started[i] = time(NULL);
+    }
+ while(!stop)
+   {while((p = waitpid(-1, &status, WNOHANG)) > 0)
+       for(i = 0; i < workers; i++)
+          if(pid[i] == p)
+            {fprintf(stderr, "%s: worker %ld %s %d, restarting it\n", argv[0], (long)p,
+                     WIFSIGNALED(status) ? "killed by signal" : "exited with",
+                     WIFSIGNALED(status) ? WTERMSIG(status) : WEXITSTATUS(status));
+             if(time(NULL) - started[i] < 1) sleep(1); /* not in a tight loop */
+             pid[i] = start_worker(lfd, nsock, i, idle, &mask);
+             started[i] = time(NULL);
+            }
+    if(!stop) sigsuspend(&mask);
+   }
+ for(i = 0; i < workers; i++)
+    if(pid[i] > 0) kill(pid[i], SIGTERM);
+ while(wait(NULL) > 0);
+ if(path != NULL) unlink(path);
+ return 0;
+}
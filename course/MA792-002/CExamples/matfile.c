@@ -0,0 +1,128 @@
+/* File: CExamples/matfile.c
+   Binary matrix files; see matfile.h.
+   Compile with the program using it, e.g.
+              "gcc -Wall -std=c99 -O2 txt2mat.c matfile.c matrix.c" */
+
+#define _POSIX_C_SOURCE 200112L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "matfile.h"
+
+int matfile_open(matfile *f, const char *name)
+{matfile_header h;
+ struct stat st;
+ size_t es;
+ void *p;
+ int fd, e;
+
+ memset(f, 0, sizeof(matfile));
+ fd = open(name, O_RDONLY);
+ if(fd < 0) return -1;
+ if(fstat(fd, &st) != 0)
+   {e = errno;
+    close(fd);
+    errno = e;
+    return -1;
+   }
+ if((size_t)st.st_size < sizeof(h))
+   {close(fd);
+    errno = EINVAL;
+    return -1;
+   }
+ p = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+ e = errno;
+ close(fd); /* the mapping stays */
+ if(p == MAP_FAILED)
+   {errno = e;
+    return -1;
+   }
+ f->map = p;
+ f->len = (size_t)st.st_size;
+
+ memcpy(&h, p, sizeof(h));
+ es = matrix_elsize((int)h.dtype);
+ if(memcmp(h.magic, MATFILE_MAGIC, 8) != 0 || h.bom != MATFILE_BOM || es == 0
+    || h.stride < h.cols || h.align == 0 || h.offset % h.align != 0
+    || h.offset < sizeof(h) || h.offset > f->len
+    || (h.rows > 0 && (h.stride > (f->len - h.offset) / es / h.rows)))
+   {matfile_close(f);
+    errno = EINVAL;
+    return -1;
+   }
+ f->m = matrix_wrap((char *)p + h.offset, (int)h.dtype, (size_t)h.rows,
+                    (size_t)h.cols, (size_t)h.stride);
+ posix_madvise(p, f->len, POSIX_MADV_WILLNEED);
+ return 0;
+}
+
+void matfile_close(matfile *f)
+{if(f->map != NULL) munmap(f->map, f->len);
+ free(f->m.rowptr);
+ memset(f, 0, sizeof(matfile));
+}
+
+int matfile_write(const char *name, const matrix *m)
+{matfile_header h;
+ char *tmp;
+ FILE *out;
+ size_t es = matrix_elsize(m->dtype), i, stride;
+ int e;
+
+ if(es == 0)
+   {errno = EINVAL;
+    return -1;
+   }
+ memset(&h, 0, sizeof(h));
+ memcpy(h.magic, MATFILE_MAGIC, 8);
+ h.bom = MATFILE_BOM;
+ h.dtype = (uint32_t)m->dtype;
+ /* the file has the stride matrix_alloc would give, not that of m: a
+    view (matrix_sub, matrix_wrap) has the stride of its parent */
+ stride = matrix_stride(m->dtype, m->cols);
+ h.rows = m->rows; h.cols = m->cols; h.stride = stride;
+ h.align = MATRIX_ALIGN;
+ h.offset = sizeof(h); /* 64, so the page aligned mapping aligns the rows */
+
+ tmp = malloc(strlen(name) + 5);
+ if(tmp == NULL) return -1;
+ sprintf(tmp, "%s.tmp", name);
+ out = fopen(tmp, "wb");
+ if(out == NULL)
+   {free(tmp);
+    return -1;
+   }
+ fwrite(&h, sizeof(h), 1, out);
+  /* the columns of each row, and zeros up to the stride */
+ for(i=0; i<m->rows; i++)
+    {static const char zeros[MATRIX_ALIGN];
+     size_t pad = (stride - m->cols) * es;
+     fwrite((const char *)m->data + i * m->stride * es, es, m->cols, out);
+     while(pad > 0)
+       {size_t k = pad < sizeof(zeros) ? pad : sizeof(zeros);
+        fwrite(zeros, 1, k, out);
+        pad -= k;
+       }
+    }
+ if(ferror(out) | fclose(out))
+   {e = errno;
+    remove(tmp);
+    free(tmp);
+    errno = e;
+    return -1;
+   }
+ if(rename(tmp, name) != 0)
+   {e = errno;
+    remove(tmp);
+    free(tmp);
+    errno = e;
+    return -1;
+   }
+ free(tmp);
+ return 0;
+}
@@ -0,0 +1,67 @@
+/* File: CExamples/matfile.h
+   Binary files of the matrices of matrix.h, loaded with one mmap and no
+   parsing.  A file is a 64 byte header followed by the elements, row by
+   row, each row padded to the stride as in memory:
+
+     bytes  0- 7  "MA792MAT"
+            8-11  byte order mark 0x01020304, as written
+           12-15  dtype, MATRIX_FLOAT or MATRIX_DOUBLE
+           16-23  rows
+           24-31  cols
+           32-39  stride, in elements
+           40-47  offset of element (0,0) in the file, a multiple of align
+           48-51  align, MATRIX_ALIGN
+           52-63  zero
+
+   The integers are in the byte order of the machine that wrote the
+   file; a file with the other order is refused.  Missing values are
+   NaN.  Needs C99 and POSIX; link with matfile.c and matrix.c. */
+
+#ifndef MATFILE_H
+#define MATFILE_H
+
+#include <stdint.h>
+#include <stddef.h> /* for size_t */
+#include "matrix.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MATFILE_MAGIC "MA792MAT"
+#define MATFILE_BOM   0x01020304u
+
+typedef struct {
+  char magic[8];
+  uint32_t bom, dtype;
+  uint64_t rows, cols, stride, offset;
+  uint32_t align;
+  char zero[12];
+} matfile_header;
+
+/* a mapped file and the matrix view of its elements */
+typedef struct {
+  matrix m;      /* a view: do not matrix_free it */
+  void *map;
+  size_t len;
+} matfile;
+
+/* map the file name and check its header; the elements can be changed
+   in memory (copy on write), the file stays as it is.  Return 0, or -1
+   with errno set (EINVAL for a file that is not a matrix). */
+int matfile_open(matfile *f, const char *name);
+
+/* unmap the file */
+void matfile_close(matfile *f);
+
+/* write m to the file name, through name.tmp and a rename so that a
+   reader never sees half a file; the rows have the stride of
+   matrix_stride, whatever that of m (a view has its parent's); return
+   0, or -1 with errno set */
+int matfile_write(const char *name, const matrix *m);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MATFILE_H */
@@ -0,0 +1,105 @@
+/* File: CExamples/matrix.c
+   Aligned contiguous matrices; see matrix.h.
+   Compile with the program using it, e.g.
+              "gcc -Wall -std=c99 -O2 -march=native arrays.c matrix.c" */
+
+#define _POSIX_C_SOURCE 200112L /* for posix_memalign */
+#include <stdlib.h>
+#include <string.h>
+#include "matrix.h"
+
+size_t matrix_elsize(int dtype)
+{switch(dtype){
+ case MATRIX_FLOAT:  return sizeof(float);
+ case MATRIX_DOUBLE: return sizeof(double);
+ default: return 0;
+ }
+}
+
+size_t matrix_stride(int dtype, size_t cols)
+{size_t es = matrix_elsize(dtype), per = MATRIX_ALIGN / es;
+ size_t stride = (cols + per - 1) / per * per;
+ if(stride * es % 4096 == 0) stride += per;
+ return stride;
+}
+
+int matrix_alloc_stride(matrix *m, int dtype, size_t rows, size_t cols,
+                        size_t stride)
+{size_t es = matrix_elsize(dtype), bytes;
+ void *p;
+
+ memset(m, 0, sizeof(matrix));
+ if(es == 0 || stride < cols) return -1;
+ bytes = rows * stride * es;
+ if(bytes == 0) bytes = MATRIX_ALIGN; /* a pointer that can be freed */
+ if(posix_memalign(&p, MATRIX_ALIGN, bytes) != 0) return -1;
+ memset(p, 0, bytes);
+ m->data = m->block = p;
+ m->rows = rows; m->cols = cols; m->stride = stride;
+ m->dtype = dtype;
+ return 0;
+}
+
+int matrix_alloc(matrix *m, int dtype, size_t rows, size_t cols)
+{if(matrix_elsize(dtype) == 0)
+   {memset(m, 0, sizeof(matrix));
+    return -1;
+   }
+ return matrix_alloc_stride(m, dtype, rows, cols, matrix_stride(dtype, cols));
+}
+
+matrix matrix_wrap(void *data, int dtype, size_t rows, size_t cols,
+                   size_t stride)
+{matrix v;
+ memset(&v, 0, sizeof(v));
+ v.data = data;
+ v.rows = rows; v.cols = cols; v.stride = stride;
+ v.dtype = dtype;
+ return v;
+}
+
+matrix matrix_sub(const matrix *m, size_t i, size_t j, size_t rows, size_t cols)
+{size_t es = matrix_elsize(m->dtype);
+ /* clip to m */
+ if(i > m->rows) i = m->rows;
+ if(j > m->cols) j = m->cols;
+ if(rows > m->rows - i) rows = m->rows - i;
+ if(cols > m->cols - j) cols = m->cols - j;
+ return matrix_wrap((char *)m->data + (i * m->stride + j) * es, m->dtype,
+                    rows, cols, m->stride);
+}
+
+/* one pointer more, so that malloc(0) is never asked for */
+float **matrix_frows(matrix *m)
+{float **r;
+ size_t i;
+ if(m->dtype != MATRIX_FLOAT) return NULL;
+ if(m->rowptr == NULL)
+   {r = malloc((m->rows + 1) * sizeof(float *));
+    if(r == NULL) return NULL;
+    for(i=0; i<m->rows; i++) r[i] = &MATRIX_F(m, i, 0);
+    m->rowptr = r;
+   }
+ return m->rowptr;
+}
+
+double **matrix_drows(matrix *m)
+{double **r;
+ size_t i;
+ if(m->dtype != MATRIX_DOUBLE) return NULL;
+ if(m->rowptr == NULL)
+   {r = malloc((m->rows + 1) * sizeof(double *));
+    if(r == NULL) return NULL;
+    for(i=0; i<m->rows; i++) r[i] = &MATRIX_D(m, i, 0);
+    m->rowptr = r;
+   }
+ return m->rowptr;
+}
+
+void matrix_free(matrix *m)
+{free(m->block);
+ free(m->rowptr);
+ m->data = m->block = NULL;
+ m->rowptr = NULL;
+ m->rows = m->cols = 0;
+}
@@ -0,0 +1,76 @@
+/* File: CExamples/matrix.h
+   Matrices of float or double in one aligned block, row by row, as the
+   float xy[5][6] of arrays.c but of any size and on the heap.  Each row
+   starts on a 64 byte boundary (a cache line, and a full AVX-512
+   register): the stride, the distance of two rows in elements, is the
+   number of columns rounded up to it.  A matrix may also be a view,
+   e.g. a submatrix, that points into the elements of another.
+   matrix_frows/matrix_drows give an array of row pointers, so that
+   code written for the float* xptr[] style of arrays.c still works.
+   Needs C99; link with matrix.c. */
+
+#ifndef MATRIX_H
+#define MATRIX_H
+
+#include <stddef.h> /* for size_t */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MATRIX_ALIGN 64 /* bytes */
+
+enum {MATRIX_FLOAT = 1, MATRIX_DOUBLE = 2};
+
+typedef struct {
+  void *data;     /* element (0,0) */
+  size_t rows, cols;
+  size_t stride;  /* elements from one row to the next, >= cols */
+  int dtype;      /* MATRIX_FLOAT or MATRIX_DOUBLE */
+  void *block;    /* the allocation, NULL for a view */
+  void *rowptr;   /* row pointers of matrix_frows/drows, or NULL */
+} matrix;
+
+/* element (i,j) of a float or double matrix m, as an lvalue */
+#define MATRIX_F(m, i, j) (((float *)(m)->data)[(size_t)(i) * (m)->stride + (j)])
+#define MATRIX_D(m, i, j) (((double *)(m)->data)[(size_t)(i) * (m)->stride + (j)])
+
+/* bytes per element of dtype, 0 if it is not one */
+size_t matrix_elsize(int dtype);
+
+/* the stride matrix_alloc uses for cols columns: whole cache lines,
+   plus one more if a row would be a multiple of 4096 bytes, so that
+   going down a column does not hit the same few cache sets each time */
+size_t matrix_stride(int dtype, size_t cols);
+
+/* a rows x cols matrix of zeros; return 0, or -1 if out of memory */
+int matrix_alloc(matrix *m, int dtype, size_t rows, size_t cols);
+
+/* as matrix_alloc, but with the given stride (>= cols), e.g. cols
+   itself for no padding at all */
+int matrix_alloc_stride(matrix *m, int dtype, size_t rows, size_t cols,
+                        size_t stride);
+
+/* a view of elements that are somewhere else, e.g. of float xy[5][6]
+   as matrix_wrap(xy, MATRIX_FLOAT, 5, 6, 6) */
+matrix matrix_wrap(void *data, int dtype, size_t rows, size_t cols,
+                   size_t stride);
+
+/* a view of the rows x cols submatrix of m starting at (i,j); it shares
+   the elements of m, and has the stride of m */
+matrix matrix_sub(const matrix *m, size_t i, size_t j, size_t rows, size_t cols);
+
+/* an array of rows pointers to the rows of m, for code that takes
+   float** or double**; it is made on the first call and belongs to m.
+   Return NULL if out of memory or if m is of the other type. */
+float **matrix_frows(matrix *m);
+double **matrix_drows(matrix *m);
+
+/* free the elements (unless m is a view) and the row pointers */
+void matrix_free(matrix *m);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MATRIX_H */
@@ -0,0 +1,105 @@
+/* File: CExamples/matrix_bench.c
+   Goes through an n x n float matrix by rows and by columns, stored
+     - as in arrays.c, one calloc per row, reached through float* xptr[],
+     - in one block without padding (stride n),
+     - in one block from matrix_alloc (rows padded, see matrix.h),
+   and prints the time per element.  By rows all of them stream through
+   memory; by columns each element is on a new cache line (and page),
+   and with n a power of 2 the unpadded rows can map a column onto a
+   few cache sets.
+   Run as "matrix_bench [n]" (default 2048).
+   Compile as "gcc -Wall -std=c99 -O2 -march=native matrix_bench.c matrix.c" */
+
+#define _POSIX_C_SOURCE 199309L /* for clock_gettime */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "matrix.h"
+
+/* seconds since some fixed time */
+static double now(void)
+{struct timespec ts;
+ clock_gettime(CLOCK_MONOTONIC, &ts);
+ return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+/* add 1 to each element of the xptr style, by rows and by columns;
+   unlike a sum this has no chain of dependent additions, so the time
+   is that of getting the elements from memory and back */
+static void ptr_rows(float **x, size_t n)
+{size_t i, j;
+ for(i=0; i<n; i++)
+    for(j=0; j<n; j++) x[i][j] += 1;
+}
+
+static void ptr_cols(float **x, size_t n)
+{size_t i, j;
+ for(j=0; j<n; j++)
+    for(i=0; i<n; i++) x[i][j] += 1;
+}
+
+/* the same for a matrix */
+static void mat_rows(matrix *m)
+{size_t i, j;
+ for(i=0; i<m->rows; i++)
+    for(j=0; j<m->cols; j++) MATRIX_F(m, i, j) += 1;
+}
+
+static void mat_cols(matrix *m)
+{size_t i, j;
+ for(j=0; j<m->cols; j++)
+    for(i=0; i<m->rows; i++) MATRIX_F(m, i, j) += 1;
+}
+
+/* run pass, repeated until 0.2 s have passed, and print ns per element */
+#define TIME(pass, n) \
+  {double t0 = now(), t; long r = 0; \
+   do {pass; r++;} while((t = now() - t0) < 0.2); \
+   printf(" %8.3f", t / r / ((double)(n) * (n)) * 1e9); \
+  }
+
+int main(int argc, char **argv)
+{size_t n = 2048, i, j;
+ float **xptr, **prow;
+ matrix flat, padded;
+
+ if(argc > 1) n = (size_t)atol(argv[1]);
+ xptr = malloc(n * sizeof(float *));
+ if(xptr == NULL
+    || matrix_alloc_stride(&flat, MATRIX_FLOAT, n, n, n) != 0
+    || matrix_alloc(&padded, MATRIX_FLOAT, n, n) != 0
+    || (prow = matrix_frows(&padded)) == NULL)
+   {fprintf(stderr, "Out of memory\n");
+    return 1;
+   }
+ for(i=0; i<n; i++)
+    {xptr[i] = (float *)calloc(n, sizeof(float));
+     if(xptr[i] == NULL)
+       {fprintf(stderr, "Out of memory\n");
+        return 1;
+       }
+     for(j=0; j<n; j++)
+        xptr[i][j] = MATRIX_F(&flat, i, j) = MATRIX_F(&padded, i, j) = i + 0.001f * j;
+    }
+
+ printf("n = %lu, ns per element     by rows  by cols\n", (unsigned long)n);
+ printf("calloc per row (xptr)      ");
+ TIME(ptr_rows(xptr, n), n);
+ TIME(ptr_cols(xptr, n), n);
+ printf("\none block, stride %-9lu", (unsigned long)flat.stride);
+ TIME(mat_rows(&flat), n);
+ TIME(mat_cols(&flat), n);
+ printf("\none block, stride %-9lu", (unsigned long)padded.stride);
+ TIME(mat_rows(&padded), n);
+ TIME(mat_cols(&padded), n);
+ printf("\nrow pointers of the block  ");
+ TIME(ptr_rows(prow, n), n);
+ TIME(ptr_cols(prow, n), n);
+ printf("\n");
+
+ for(i=0; i<n; i++) free(xptr[i]);
+ free(xptr);
+ matrix_free(&flat);
+ matrix_free(&padded);
+ return 0;
+}
@@ -16,218 +16,376 @@
  * software. We have supposed that 'int' has a size of at least 32 bits. If
  * your compiler supports 'long long' integers of 64 bits, you may use the
  * integer version of 'mul_mod' (see HAS_LONG_LONG).  
+ *
+ * The modular kernels (mul_mod, pow_mod, inv_mod, ...) live in pimod.h,
+ * which is shared with the BBP hexadecimal program bbp.c.
  */
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
+#include <time.h>
 
-/* uncomment the following line to use 'long long' integers */
-/* #define HAS_LONG_LONG */
-
-#ifdef HAS_LONG_LONG
-#define mul_mod(a,b,m) (( (long long) (a) * (long long) (b) ) % (m))
-#else
-#define mul_mod(a,b,m) fmod( (double) a * (double) b, m)
-#endif
-
-/* return the inverse of x mod y */
-int inv_mod(int x,int y) {
-  int q,u,v,a,c,t;
-
-  u=x;
-  v=y;
-  c=1;
-  a=0;
-  do {
-    q=v/u;
-    
-    t=c;
-    c=a-q*c;
-    a=t;
-    
-    t=u;
-    u=v-q*u;
-    v=t;
-  } while (u!=0);
-  a=a%y;
-  if (a<0) a=y+a;
-  return a;
+#include "pimod.h"
+
+#define DIVN(t,a,v,vinc,kq,kqinc)		\
+{						\
+  kq+=kqinc;					\
+  if (kq >= a) {				\
+    do { kq-=a; } while (kq>=a);		\
+    if (kq == 0) {				\
+      do {					\
+	t=t/a;					\
+	v+=vinc;				\
+      } while ((t % a) == 0);			\
+    }						\
+  }						\
 }
 
-/* return the inverse of u mod v, if v is odd */
-int inv_mod2(int u,int v) {
-  int u1,u3,v1,v3,t1,t3;
-  
-  u1=1;
-  u3=u;
-  
-  v1=v;
-  v3=v;
-  
-  if ((u&1)!=0) {
-    t1=0;
-    t3=-v;
-    goto Y4;
+/* algorithm modes for the k-loop */
+#define MODE_INVERT   0 /* one modular inversion per term (original method) */
+#define MODE_DEFERRED 1 /* running fraction, one inversion per prime */
+
+/*
+ * return the contribution of the prime a to the fractional part of
+ * pi*10^(n-1), as a number in [0,1).
+ *
+ * In MODE_DEFERRED the terms num*a^(vmax-v)*(25k-3)/den are accumulated
+ * as a single fraction P/Q mod av: P/Q + x/d = (P*d + x*Q)/(Q*d). Since
+ * every den is prime to a, Q stays invertible and we only need one
+ * extended Euclid per prime instead of one per term. The trade is about
+ * three extra mul_mod per term, so this pays off with HAS_LONG_LONG; with
+ * the fmod() version of mul_mod both modes run at about the same speed.
+ */
+double prime_sum(int a,int n,int N,int mode)
+{
+  int av,vmax,num,den,k,kq1,kq2,kq3,kq4,t,v,s,i,t1,P,Q,nt;
+
+  vmax=(int)(log(3*N)/log(a));
+  if (a==2) {
+    vmax=vmax+(N-n);
+    if (vmax<=0) return 0;
+  }
+  av=1;
+  for(i=0;i<vmax;i++) av=av*a;
+
+  s=0;
+  P=0;
+  Q=1;
+  nt=0;
+  den=1;
+  kq1=0;
+  kq2=-1;
+  kq3=-3;
+  kq4=-2;
+  if (a==2) {
+    num=1;
+    v=-n; 
   } else {
-    t1=1;
-    t3=u;
+    num=pow_mod(2,n,av);
+    v=0;
   }
-  
-  do {
+
+  for(k=1;k<=N;k++) {
+
+    t=2*k;
+    DIVN(t,a,v,-1,kq1,2);
+    num=mul_mod(num,t,av);
     
-    do {
-      if ((t1&1)==0) {
-	t1=t1>>1;
-	t3=t3>>1;
+    t=2*k-1;
+    DIVN(t,a,v,-1,kq2,2);
+    num=mul_mod(num,t,av);
+
+    t=3*(3*k-1);
+    DIVN(t,a,v,1,kq3,9);
+    den=mul_mod(den,t,av);
+
+    t=(3*k-2);
+    DIVN(t,a,v,1,kq4,3);
+    if (a!=2) t=t*2; else v++;
+    den=mul_mod(den,t,av);
+    
+    if (v > 0) {
+      if (mode==MODE_DEFERRED) {
+	t=num;
+	for(i=v;i<vmax;i++) t=mul_mod(t,a,av);
+	t1=(25*k-3);
+	t=mul_mod(t,t1,av);
+	P=mul_mod(P,den,av);
+	t=mul_mod(t,Q,av);
+	P+=t;
+	if (P>=av) P-=av;
+	Q=mul_mod(Q,den,av);
+	nt++;
       } else {
-	t1=(t1+v)>>1;
-	t3=t3>>1;
+	if (a!=2) t=inv_mod2(den,av);
+	else t=inv_mod(den,av);
+	t=mul_mod(t,num,av);
+	for(i=v;i<vmax;i++) t=mul_mod(t,a,av);
+	t1=(25*k-3);
+	t=mul_mod(t,t1,av);
+	s+=t;
+	if (s>=av) s-=av;
       }
-      Y4:
-    } while ((t3&1)==0);
-    
-    if (t3>=0) {
-      u1=t1;
-      u3=t3;
-    } else {
-      v1=v-t1;
-      v3=-t3;
     }
-    t1=u1-v1;
-    t3=u3-v3;
-    if (t1<0) {
-      t1=t1+v;
-    }
-  } while (t3 != 0);
-  return u1;
+  }
+
+  if (mode==MODE_DEFERRED && nt>0) {
+    if (a!=2) t=inv_mod2(Q,av);
+    else t=inv_mod(Q,av);
+    s=mul_mod(P,t,av);
+  }
+
+  t=pow_mod(5,n-1,av);
+  s=mul_mod(s,t,av);
+  return (double) s/ (double) av;
 }
 
+/* number of terms of the series needed for position n */
+int terms_for(int n)
+{
+  return (int)((n+20)*log(10)/log(13.5));
+}
+
+/*
+ * Checkpoint files hold one line
+ *
+ *   pi1 <n> <lo> <hi> <a> <sum>
+ *
+ * meaning that all primes in [lo,a) have been added to sum, and the primes
+ * in [a,hi] are still to do. A range is complete when a > hi. The sum is
+ * written with 17 significant digits so that it reads back exactly.
+ */
+
+/* write the checkpoint to file (via a temporary and rename, so that a
+   crash never leaves a half written file); return 0 on success */
+int save_checkpoint(char *file,int n,int lo,int hi,int a,double sum)
+{
+  char tmp[1024];
+  FILE *f;
+
+  if (strlen(file)+5 > sizeof(tmp)) return -1;
+  sprintf(tmp,"%s.tmp",file);
+  f=fopen(tmp,"w");
+  if (f==NULL) return -1;
+  fprintf(f,"pi1 %d %d %d %d %.17g\n",n,lo,hi,a,sum);
+  if (fclose(f)!=0) return -1;
+  return rename(tmp,file);
+}
+
+/* return the first prime >= n */
+int first_prime(int n)
+{
+  return n<=2 ? 2 : next_prime(n-1);
+}
+
+/*
+ * read a checkpoint written by save_checkpoint; return 0 on success, -1 if
+ * it cannot be read and -2 if what it holds cannot come from a run (a
+ * frontier a that is not a prime would make the prime walk loop forever).
+ * Note that is_prime(2) is false.
+ */
+int load_checkpoint(char *file,int *n,int *lo,int *hi,int *a,double *sum)
+{
+  FILE *f;
+  int r;
+
+  f=fopen(file,"r");
+  if (f==NULL) return -1;
+  r=fscanf(f,"pi1 %d %d %d %d %lf",n,lo,hi,a,sum);
+  fclose(f);
+  if (r!=5) return -1;
+  if (*n<=0 || *lo>*a || *hi>3*terms_for(*n)) return -2;
+  if (*a!=2 && (*a<2 || !is_prime(*a))) return -2;
+  /* past hi, a can only be the first prime after the range */
+  if (*a>*hi && *a!=first_prime(*lo>*hi ? *lo : *hi+1)) return -2;
+  if (!(*sum>=0 && *sum<1)) return -2;
+  return 0;
+}
 
-/* return (a^b) mod m */
-int pow_mod(int a,int b,int m)
+/*
+ * add the primes in [*pa,hi] to *psum. If ckfile is not NULL, the frontier
+ * is saved there every ckint seconds and once more at the end.
+ */
+void sum_range(int n,int mode,int lo,int hi,int *pa,double *psum,
+	       char *ckfile,int ckint)
 {
-  int r,aa;
-   
-  r=1;
-  aa=a;
-  while (1) {
-    if (b&1) r=mul_mod(r,aa,m);
-    b=b>>1;
-    if (b == 0) break;
-    aa=mul_mod(aa,aa,m);
+  int a,N;
+  double sum;
+  time_t last;
+
+  N=terms_for(n);
+  a=*pa;
+  sum=*psum;
+  last=time(NULL);
+
+  for(;a<=hi;a=next_prime(a)) {
+    sum=fmod(sum+prime_sum(a,n,N,mode),1.0);
+    if (ckfile!=NULL && time(NULL)-last>=ckint) {
+      if (save_checkpoint(ckfile,n,lo,hi,next_prime(a),sum)!=0)
+	fprintf(stderr,"cannot write checkpoint %s\n",ckfile);
+      last=time(NULL);
+    }
   }
-  return r;
+  if (ckfile!=NULL && save_checkpoint(ckfile,n,lo,hi,a,sum)!=0)
+    fprintf(stderr,"cannot write checkpoint %s\n",ckfile);
+  *pa=a;
+  *psum=sum;
 }
-      
-/* return true if n is prime */
-int is_prime(int n)
+
+/* return the 9 decimal digits of pi starting at position n */
+int pi_digits(int n,int mode)
 {
-   int r,i;
-   if ((n % 2) == 0) return 0;
+  int a;
+  double sum;
 
-   r=(int)(sqrt(n));
-   for(i=3;i<=r;i+=2) if ((n % i) == 0) return 0;
-   return 1;
+  a=2;
+  sum=0;
+  sum_range(n,mode,2,3*terms_for(n),&a,&sum,NULL,0);
+  return (int)(sum*1e9);
 }
 
-/* return the prime number immediatly after n */
-int next_prime(int n)
+/*
+ * add up the finished partial sums in files[0..nfiles-1]. The prime ranges
+ * must be for the same n and must tile [2,3N] without gaps or overlaps.
+ */
+int merge_checkpoints(char **files,int nfiles)
 {
-   do {
-      n++;
-   } while (!is_prime(n));
-   return n;
+  int i,j,r,n,n0,lo,hi,a,*los,*his,next;
+  double sum,total;
+
+  los=malloc(nfiles*sizeof(int));
+  his=malloc(nfiles*sizeof(int));
+  n0=0;
+  total=0;
+  for(i=0;i<nfiles;i++) {
+    r=load_checkpoint(files[i],&n,&lo,&hi,&a,&sum);
+    if (r!=0) {
+      fprintf(stderr,r==-2 ? "%s: not a valid checkpoint\n"
+	      : "cannot read checkpoint %s\n",files[i]);
+      exit(1);
+    }
+    if (a<=hi) {
+      fprintf(stderr,"%s: range [%d,%d] stopped at %d, resume it first\n",
+	      files[i],lo,hi,a);
+      exit(1);
+    }
+    if (i>0 && n!=n0) {
+      fprintf(stderr,"%s: position %d, expected %d\n",files[i],n,n0);
+      exit(1);
+    }
+    n0=n;
+    los[i]=lo;
+    his[i]=hi;
+    total=fmod(total+sum,1.0);
+  }
+
+  /* check that the ranges tile [2,3N]; nfiles is small, so search */
+  next=2;
+  for(i=0;i<nfiles;i++) {
+    for(j=0;j<nfiles;j++) if (los[j]<=next && his[j]>=next) break;
+    if (j==nfiles) break;
+    next=his[j]+1;
+  }
+  if (next<=3*terms_for(n0)) {
+    fprintf(stderr,"primes from %d on are not covered\n",next);
+    exit(1);
+  }
+  for(i=0;i<nfiles;i++) for(j=i+1;j<nfiles;j++)
+    if (los[i]<=his[j] && los[j]<=his[i]) {
+      fprintf(stderr,"%s and %s overlap\n",files[i],files[j]);
+      exit(1);
+    }
+  free(los);
+  free(his);
+
+  printf("Decimal digits of pi at position %d: %09d\n",n0,(int)(total*1e9));
+  return 0;
 }
 
-#define DIVN(t,a,v,vinc,kq,kqinc)		\
-{						\
-  kq+=kqinc;					\
-  if (kq >= a) {				\
-    do { kq-=a; } while (kq>=a);		\
-    if (kq == 0) {				\
-      do {					\
-	t=t/a;					\
-	v+=vinc;				\
-      } while ((t % a) == 0);			\
-    }						\
-  }						\
+/* compare both modes over a grid of positions; return number of mismatches */
+int check_modes(void)
+{
+  static int grid[]={1,2,3,4,5,7,10,13,20,50,99,100,101,150,152,153,154,
+		     200,500,1000,2000,5000,10000,0};
+  int i,d1,d2,bad;
+
+  bad=0;
+  for(i=0;grid[i]!=0;i++) {
+    d1=pi_digits(grid[i],MODE_INVERT);
+    d2=pi_digits(grid[i],MODE_DEFERRED);
+    printf("%6d: %09d %09d %s\n",grid[i],d1,d2,d1==d2 ? "ok" : "MISMATCH");
+    if (d1!=d2) bad++;
+  }
+  return bad;
 }
 
 int main(int argc,char *argv[])
 {
-  int av,a,vmax,N,n,num,den,k,kq1,kq2,kq3,kq4,t,v,s,i,t1;
+  int n,mode,lo,hi,a,i,ckint,resume;
+  char *ckfile;
   double sum;
 
-  if (argc<2 || (n=atoi(argv[1])) <= 0) {
+  if (argc>=2 && strcmp(argv[1],"-c")==0) 
+    return check_modes() ? 1 : 0;
+  if (argc>=3 && strcmp(argv[1],"-m")==0) 
+    return merge_checkpoints(argv+2,argc-2);
+
+  n=0;
+  mode=MODE_INVERT;
+  lo=2;
+  hi=-1;
+  ckfile=NULL;
+  ckint=60;
+  resume=0;
+  for(i=1;i<argc;i++) {
+    if (strcmp(argv[i],"-d")==0) mode=MODE_DEFERRED;
+    else if (strcmp(argv[i],"-p")==0 && i+2<argc) {
+      lo=atoi(argv[++i]);
+      hi=atoi(argv[++i]);
+    }
+    else if (strcmp(argv[i],"-k")==0 && i+1<argc) ckfile=argv[++i];
+    else if (strcmp(argv[i],"-t")==0 && i+1<argc) ckint=atoi(argv[++i]);
+    else if (strcmp(argv[i],"--resume")==0) resume=1;
+    else if (n==0) n=atoi(argv[i]);
+    else n=-1;
+  }
+
+  if ((n<=0 && !resume) || (resume && ckfile==NULL)) {
     printf("This program computes the n'th decimal digit of pi\n"
-	   "usage: pi n , where n is the digit you want\n"
+	   "usage: pi n [-d] [-p lo hi] [-k file [-t secs]]\n"
+	   "         n        the digit you want\n"
+	   "         -d       accumulates each prime as one fraction\n"
+	   "         -p       only sums the primes in [lo,hi]\n"
+	   "         -k       saves progress to file every secs (60) seconds\n"
+	   "       pi --resume -k file [-d] [-t secs]\n"
+	   "                  continues the run saved in file\n"
+	   "       pi -m file... adds up the partial sums of finished ranges\n"
+	   "       pi -c      checks both methods on a grid of positions\n"
 	   );
     exit(1);
   }
-  
-  N=(int)((n+20)*log(10)/log(13.5));
-  sum=0;
 
-  for(a=2;a<=(3*N);a=next_prime(a)) {
-    vmax=(int)(log(3*N)/log(a));
-    if (a==2) {
-      vmax=vmax+(N-n);
-      if (vmax<=0) continue;
-    }
-    av=1;
-    for(i=0;i<vmax;i++) av=av*a;
-
-    s=0;
-    den=1;
-    kq1=0;
-    kq2=-1;
-    kq3=-3;
-    kq4=-2;
-    if (a==2) {
-      num=1;
-      v=-n; 
-    } else {
-      num=pow_mod(2,n,av);
-      v=0;
+  if (resume) {
+    i=load_checkpoint(ckfile,&n,&lo,&hi,&a,&sum);
+    if (i!=0) {
+      fprintf(stderr,i==-2 ? "%s: not a valid checkpoint\n"
+	      : "cannot read checkpoint %s\n",ckfile);
+      exit(1);
     }
+  } else {
+    if (hi<0 || hi>3*terms_for(n)) hi=3*terms_for(n);
+    a=first_prime(lo);
+    sum=0;
+  }
 
-    for(k=1;k<=N;k++) {
-
-      t=2*k;
-      DIVN(t,a,v,-1,kq1,2);
-      num=mul_mod(num,t,av);
-      
-      t=2*k-1;
-      DIVN(t,a,v,-1,kq2,2);
-      num=mul_mod(num,t,av);
-
-      t=3*(3*k-1);
-      DIVN(t,a,v,1,kq3,9);
-      den=mul_mod(den,t,av);
-
-      t=(3*k-2);
-      DIVN(t,a,v,1,kq4,3);
-      if (a!=2) t=t*2; else v++;
-      den=mul_mod(den,t,av);
-      
-      if (v > 0) {
-	if (a!=2) t=inv_mod2(den,av);
-	else t=inv_mod(den,av);
-	t=mul_mod(t,num,av);
-	for(i=v;i<vmax;i++) t=mul_mod(t,a,av);
-	t1=(25*k-3);
-	t=mul_mod(t,t1,av);
-	s+=t;
-	if (s>=av) s-=av;
-      }
-    }
+  sum_range(n,mode,lo,hi,&a,&sum,ckfile,ckint);
 
-    t=pow_mod(5,n-1,av);
-    s=mul_mod(s,t,av);
-    sum=fmod(sum+(double) s/ (double) av,1.0);
-  }
-  printf("Decimal digits of pi at position %d: %09d\n",n,(int)(sum*1e9));
+  if (lo<=2 && hi>=3*terms_for(n))
+    printf("Decimal digits of pi at position %d: %09d\n",n,(int)(sum*1e9));
+  else
+    printf("Partial sum for primes in [%d,%d] at position %d: %.17g\n",
+	   lo,hi,n,sum);
   return 0;
 }
-   
@@ -0,0 +1,33 @@
+#!/bin/sh
+# File: CExamples/pi_bench.sh
+# Times the decimal engine pi1.c (both k-loop modes) against the BBP
+# hexadecimal engine bbp.c over a range of digit positions.
+# Run as "sh pi_bench.sh [threads] [positions...]"
+
+THREADS=${1:-1}
+[ $# -gt 0 ] && shift
+POSITIONS=${*:-"100 1000 3000 10000 30000 1000000 10000000"}
+
+gcc -Wall -O2 -o pi1_bench pi1.c -lm || exit 1
+gcc -Wall -O2 -pthread -o bbp_bench bbp.c -lm || exit 1
+
+# seconds taken by the command line in "$@"
+elapsed()
+{ start=$(date +%s.%N)
+  "$@" > /dev/null
+  end=$(date +%s.%N)
+  echo "$start $end" | awk '{printf "%10.3f", $2-$1}'
+}
+
+printf "%9s %10s %10s %10s\n" position pi1 "pi1 -d" "bbp x$THREADS"
+for n in $POSITIONS
+do
+   # the decimal engine is O(n^2); skip it where it would take hours
+   if [ "$n" -le 30000 ]
+   then t1=$(elapsed ./pi1_bench "$n"); t2=$(elapsed ./pi1_bench "$n" -d)
+   else t1=$(printf "%10s" -); t2=$t1
+   fi
+   t3=$(elapsed ./bbp_bench "$n" "$THREADS")
+   printf "%9d %s %s %s\n" "$n" "$t1" "$t2" "$t3"
+done
+rm -f pi1_bench bbp_bench
@@ -0,0 +1,149 @@
+/*
+ * pimod.h: modular arithmetic kernels shared by the digit-of-pi programs
+ * pi1.c (decimal, Plouffe/Gosper) and bbp.c (hexadecimal, BBP).
+ * Split out of Fabrice Bellard's pi1.c.
+ *
+ * All moduli are ints; with the fmod() version of mul_mod they must stay
+ * below 2^26 so that the double product is exact.
+ */
+
+#ifndef PIMOD_H
+#define PIMOD_H
+
+#include <math.h>
+
+/* 'long long' products are much faster than fmod(); use them whenever the
+   compiler has them. Define NO_LONG_LONG to force the double version. */
+#if !defined(HAS_LONG_LONG) && !defined(NO_LONG_LONG) && \
+    (defined(__GNUC__) || (defined(__STDC_VERSION__) && __STDC_VERSION__ >= 199901L))
+#define HAS_LONG_LONG
+#endif
+
+/* the kernels are static, so that the header can be included in several
+   files of one program, and inline where the compiler knows the word
+   (C99, or gcc even with -ansi), so that a file using only some of them
+   gets no warning about the others */
+#if defined(__GNUC__)
+#define PIMOD_FN static __inline__
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 199901L
+#define PIMOD_FN static inline
+#else
+#define PIMOD_FN static
+#endif
+
+#ifdef HAS_LONG_LONG
+#define mul_mod(a,b,m) (( (long long) (a) * (long long) (b) ) % (m))
+#else
+#define mul_mod(a,b,m) fmod( (double) a * (double) b, m)
+#endif
+
+/* return the inverse of x mod y */
+PIMOD_FN int inv_mod(int x,int y) {
+  int q,u,v,a,c,t;
+
+  u=x;
+  v=y;
+  c=1;
+  a=0;
+  do {
+    q=v/u;
+    
+    t=c;
+    c=a-q*c;
+    a=t;
+    
+    t=u;
+    u=v-q*u;
+    v=t;
+  } while (u!=0);
+  a=a%y;
+  if (a<0) a=y+a;
+  return a;
+}
+
+/* return the inverse of u mod v, if v is odd */
+PIMOD_FN int inv_mod2(int u,int v) {
+  int u1,u3,v1,v3,t1,t3;
+  
+  u1=1;
+  u3=u;
+  
+  v1=v;
+  v3=v;
+  
+  if ((u&1)!=0) {
+    t1=0;
+    t3=-v;
+    goto Y4;
+  } else {
+    t1=1;
+    t3=u;
+  }
+  
+  do {
+    
+    do {
+      if ((t1&1)==0) {
+	t1=t1>>1;
+	t3=t3>>1;
+      } else {
+	t1=(t1+v)>>1;
+	t3=t3>>1;
+      }
+      Y4:
+    } while ((t3&1)==0);
+    
+    if (t3>=0) {
+      u1=t1;
+      u3=t3;
+    } else {
+      v1=v-t1;
+      v3=-t3;
+    }
+    t1=u1-v1;
+    t3=u3-v3;
+    if (t1<0) {
+      t1=t1+v;
+    }
+  } while (t3 != 0);
+  return u1;
+}
+
+
+/* return (a^b) mod m */
+PIMOD_FN int pow_mod(int a,int b,int m)
+{
+  int r,aa;
+   
+  r=1;
+  aa=a;
+  while (1) {
+    if (b&1) r=mul_mod(r,aa,m);
+    b=b>>1;
+    if (b == 0) break;
+    aa=mul_mod(aa,aa,m);
+  }
+  return r;
+}
+      
+/* return true if n is prime */
+PIMOD_FN int is_prime(int n)
+{
+   int r,i;
+   if ((n % 2) == 0) return 0;
+
+   r=(int)(sqrt(n));
+   for(i=3;i<=r;i+=2) if ((n % i) == 0) return 0;
+   return 1;
+}
+
+/* return the prime number immediatly after n */
+PIMOD_FN int next_prime(int n)
+{
+   do {
+      n++;
+   } while (!is_prime(n));
+   return n;
+}
+
+#endif /* PIMOD_H */
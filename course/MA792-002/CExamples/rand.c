@@ -1,22 +1,73 @@
+/* File: CExamples/rand.c
+   Prints rows of 49 random bits, forever.
+   The bits are taken 64 at a time from the xoshiro256** generator in
+   xoshiro.h, seeded with <seed>; "rand <seed> libc" prints the old
+   stream, which keeps only the (weak) low bit of each rand().
+   The option "raw" writes the packed bits as bytes instead of rows.
+   With "-j <threads>", thread i generates the i-th jump-ahead substream
+   of the seeded generator and the blocks of PAR_WORDS words are printed
+   round robin (see randpar.h), so <seed> and <threads> fix the output.
+   Output goes through the buffered writer of bitout.c.
+   Compile as "gcc -Wall -std=c99 -O2 -march=native -pthread rand.c bitout.c randpar.c" */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h> /* for strcmp */
+#include <unistd.h> /* for STDOUT_FILENO */
+#include "xoshiro.h"
+#include "bitout.h"
+#include "randpar.h"
 
+#define NWORDS 1024 /* packed 64-bit words generated per block */
+#define PAR_WORDS (1 << 16) /* words per block of each thread with -j */
 
 int main(int argc, char* argv[]){
- int i;
- int seed;
+ int i, b;
+ int seed, libc = 0, width = 49, nthreads = 0;
+ uint64_t buf[NWORDS];
+ xoshiro256 g;
+ bitout out;
+ randpar *par;
  if(argc < 2)
-   {fprintf(stderr,"Error, call: %s <seed>\n",
+   {fprintf(stderr,"Error, call: %s <seed> [libc] [raw] [-j <threads>]\n",
             argv[0]);
     return 1;
    }/*end if*/
  sscanf(argv[1],"%d",&seed);
+ for(i=2; i<argc; i++)
+    if(strcmp(argv[i], "libc") == 0) libc = 1;
+    else if(strcmp(argv[i], "raw") == 0) width = 0;
+    else if(strcmp(argv[i], "-j") == 0 && i+1 < argc)
+       sscanf(argv[++i], "%d", &nthreads);
+
+ if(bitout_open(&out, STDOUT_FILENO, width, 0) < 0)
+   {fprintf(stderr, "%s: out of memory\n", argv[0]);
+    return 1;
+   }
+ if(nthreads > 0 && !libc)
+   {par = randpar_start((uint64_t)seed, nthreads, PAR_WORDS);
+    if(par == NULL)
+      {fprintf(stderr, "%s: cannot start %d threads\n", argv[0], nthreads);
+       return 1;
+      }
+    while(bitout_words(&out, randpar_next(par), PAR_WORDS) == 0)
+       ;
+    randpar_stop(par);
+    bitout_close(&out);
+    return 1;
+   }/*end if nthreads*/
+
  srand(seed);
+ xoshiro256_seed(&g, (uint64_t)seed);
  for (;;)
-   {for (i=0; i<49; i++)
-        /* print a random bit */
-        printf("%1d", 1 & rand());
-    printf("\n");
+   {if(libc)
+      for (i=0; i<NWORDS; i++)
+         {/* pack 64 random bits, the first one least significant */
+          buf[i] = 0;
+          for (b=0; b<64; b++) buf[i] |= (uint64_t)(1 & rand()) << b;
+         }
+    else xoshiro256_fill(&g, buf, NWORDS);
+    if(bitout_words(&out, buf, NWORDS) < 0) break; /* e.g. pipe closed */
    }
- return 0;
+ bitout_close(&out);
+ return 1;
 }
@@ -1,5 +1,14 @@
+/* File: CExamples/rand2.c
+   Run as "rand2" for the rand() stream seeded with 101, or as
+   "rand2 <threads>" for the xoshiro256** stream seeded with 101 and
+   generated in parallel from jump-ahead substreams (see randpar.h).
+   Compile as "gcc -Wall -std=c99 -O2 -march=native -pthread rand2.c bitout.c randpar.c" */
+#define _POSIX_C_SOURCE 200112L /* for SIGTSTP and clock_gettime */
 #include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h> /* for STDOUT_FILENO */
+#include "bitout.h"
+#include "randpar.h"
 /* more on John's question why the program cannot probe if
    the keyboard was struck:
 
@@ -20,44 +29,112 @@
                  ^Z (control-Z), a terminal stop (suspend)
                                  signal is sent.
 
-   In the code below, I catch both signals before exiting.
+   In the code below, I catch both signals.  A signal handler may
+   only call async-signal-safe functions, and fprintf and exit are
+   not: a ^C in the middle of a printf can leave stdout's buffer in
+   pieces, and the last buffer of output would be lost.  So the
+   handlers only set a flag, and main() looks at the flags after each
+   block of bits: on ^C it flushes the output, reports how many bits
+   it made and how fast, and exits; on ^Z it flushes and really stops
+   until it gets SIGCONT (from "fg" or "bg").
 */
 
 #include <signal.h>
+#include <time.h> /* for clock_gettime */
+volatile sig_atomic_t got_SIGINT = 0, got_SIGTSTP = 0;
+
 void my_SIGINT_handler(int sig) /* interrupt by ^C */
-  {/* psignal(sig, "in main()"); /* print message; not standard C */
-   fprintf(stderr,"In my main() in rand2.c: %d\n\n",sig);
-   exit(1);
+  {got_SIGINT = sig;
   }
 
 void my_SIGTSTP_handler(int sig) /* terminal stop by ^Z */
-  {/* psignal(sig, "in main()"); /* print message; not standard C */
-   fprintf(stderr,"In my main() in rand2.c: %d\n\n",sig);
-   exit(1); /* should suspend here and wait for SIGCONT signal */
+  {got_SIGTSTP = sig;
   }
 
-int main(void){
- int i;
+/* seconds since some fixed time */
+double now(void)
+{struct timespec ts;
+ clock_gettime(CLOCK_MONOTONIC, &ts);
+ return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+#define NWORDS 1024 /* packed 64-bit words per block */
+#define PAR_WORDS (1 << 16) /* words per block of each thread */
 
- /* variables that hold pointers to functions */
- void (*sys_SIGINT_handler_ptr)();
- void (*sys_SIGTSTP_handler_ptr)();
+int main(int argc, char* argv[]){
+ int i, b, nthreads = 0;
+ uint64_t buf[NWORDS];
+ const uint64_t *block;
+ size_t nwords;
+ bitout out;
+ randpar *par = NULL;
+ double start, paused = 0, stopped, seconds;
 
- /* activate signal handlers */
- sys_SIGINT_handler_ptr = signal(SIGINT, &my_SIGINT_handler);
- if( sys_SIGINT_handler_ptr == SIG_ERR)
+ /* activate signal handlers; sigaction, unlike signal() under
+    strict POSIX, keeps the handler installed after the first signal */
+ struct sigaction act;
+ act.sa_flags = 0; /* write(2) is restarted by bitout.c on EINTR */
+ sigemptyset(&act.sa_mask);
+
+ act.sa_handler = &my_SIGINT_handler;
+ if( sigaction(SIGINT, &act, NULL) != 0)
    fprintf(stderr, "?Couldn't establish new SIGINT handler.\n");
 
- sys_SIGTSTP_handler_ptr = signal(SIGTSTP, &my_SIGTSTP_handler);
- if( sys_SIGTSTP_handler_ptr == SIG_ERR)
+ act.sa_handler = &my_SIGTSTP_handler;
+ if( sigaction(SIGTSTP, &act, NULL) != 0)
    fprintf(stderr, "?Couldn't establish new SIGTSTP handler.\n");
 
- srand(101);
- for (;;)
-   {for (i=0; i<30; i++)
-        /* print a random bit */
-        printf("%1d", 1 & rand());
-    printf("\n");
+ /* rows of 30 bits, through the buffered writer of bitout.c */
+ if(bitout_open(&out, STDOUT_FILENO, 30, 0) < 0)
+   {fprintf(stderr, "Out of memory\n");
+    return 1;
+   }
+ if(argc > 1) sscanf(argv[1], "%d", &nthreads);
+ if(nthreads > 0)
+   {par = randpar_start(101, nthreads, PAR_WORDS);
+    if(par == NULL)
+      {fprintf(stderr, "Cannot start %d threads\n", nthreads);
+       return 1;
+      }
    }
- return 0;
+ else srand(101);
+
+ start = now();
+ while(!got_SIGINT)
+   {if(par != NULL)
+      {block = randpar_next(par);
+       nwords = PAR_WORDS;
+      }
+    else
+      {for (i=0; i<NWORDS; i++)
+          {/* pack 64 random bits, the first one least significant */
+           buf[i] = 0;
+           for (b=0; b<64; b++) buf[i] |= (uint64_t)(1 & rand()) << b;
+          }
+       block = buf;
+       nwords = NWORDS;
+      }
+    if(bitout_words(&out, block, nwords) < 0) break; /* e.g. pipe closed */
+
+    if(got_SIGTSTP)
+      {/* suspend for real: flush, and stop until SIGCONT; SIGSTOP,
+          unlike a second SIGTSTP, also stops an orphaned process */
+       got_SIGTSTP = 0;
+       bitout_flush(&out);
+       fprintf(stderr, "In my main() in rand2.c: suspended\n");
+       stopped = now();
+       raise(SIGSTOP);
+       paused += now() - stopped;
+       fprintf(stderr, "In my main() in rand2.c: continued\n");
+      }
+   }
+ seconds = now() - start - paused;
+
+ if(par != NULL) randpar_stop(par);
+ if(bitout_close(&out) < 0 && !got_SIGINT) return 1;
+ fprintf(stderr, "In my main() in rand2.c: %d\n"
+                 "%.0f bits in %.3f s, %.3f Gbit/s\n\n",
+         (int)got_SIGINT, (double)out.nbits, seconds,
+         seconds > 0 ? out.nbits / seconds * 1e-9 : 0.0);
+ return got_SIGINT ? 0 : 1;
 }
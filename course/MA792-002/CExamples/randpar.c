@@ -0,0 +1,153 @@
+/* File: CExamples/randpar.c
+   Parallel generation of one reproducible bit stream; see randpar.h.
+   Each thread fills two slots in turn, so that it can work on one
+   block while the caller uses the other.
+   Compile with the program using it, e.g.
+        "gcc -Wall -std=c99 -O2 -march=native -pthread rand.c bitout.c randpar.c" */
+
+#define _POSIX_C_SOURCE 200112L /* for posix_memalign */
+#include <stdlib.h>
+#include <pthread.h>
+#include "xoshiro.h"
+#include "randpar.h"
+
+#define NSLOTS 2
+
+struct worker {
+  randpar *p;
+  xoshiro256 g;              /* this thread's substream */
+  uint64_t *slot[NSLOTS];
+  int full[NSLOTS];          /* slot filled and not yet given back */
+  int stop;                  /* set by randpar_stop */
+  pthread_mutex_t m;         /* protects full[] and stop */
+  pthread_cond_t c;
+  pthread_t tid;
+  int started;
+};
+
+struct randpar {
+  int nthreads;
+  size_t block_words;
+  uint64_t k;                /* blocks handed out so far */
+  int held;                  /* 1 if the caller still has block k-1 */
+  struct worker *w;
+};
+
+static void *worker_main(void *arg)
+{struct worker *w = arg;
+ uint64_t r;
+ int s;
+ for(r=0;; r++)
+    {s = (int)(r % NSLOTS);
+     pthread_mutex_lock(&w->m);
+     while(w->full[s] && !w->stop) pthread_cond_wait(&w->c, &w->m);
+     if(w->stop)
+       {pthread_mutex_unlock(&w->m);
+        break;
+       }
+     pthread_mutex_unlock(&w->m);
+
+     xoshiro256_fill(&w->g, w->slot[s], w->p->block_words);
+
+     pthread_mutex_lock(&w->m);
+     w->full[s] = 1;
+     pthread_cond_broadcast(&w->c);
+     pthread_mutex_unlock(&w->m);
+    }
+ return NULL;
+}
+
+randpar *randpar_start(uint64_t seed, int nthreads, size_t block_words)
+{randpar *p;
+ struct worker *w;
+ xoshiro256 g;
+ void *mem;
+ int i, s;
+
+ if(nthreads < 1) nthreads = 1;
+ p = calloc(1, sizeof(randpar));
+ if(p == NULL) return NULL;
+ p->w = calloc((size_t)nthreads, sizeof(struct worker));
+ if(p->w == NULL)
+   {free(p);
+    return NULL;
+   }
+ p->nthreads = nthreads;
+ p->block_words = block_words;
+
+ xoshiro256_seed(&g, seed);
+ for(i=0; i<nthreads; i++)
+    {w = &p->w[i];
+     w->p = p;
+     w->g = g;
+     xoshiro256_jump(&g);
+     pthread_mutex_init(&w->m, NULL);
+     pthread_cond_init(&w->c, NULL);
+    }
+ for(i=0; i<nthreads; i++)
+    for(s=0; s<NSLOTS; s++)
+       {if(posix_memalign(&mem, 64, block_words * sizeof(uint64_t)) != 0)
+          {randpar_stop(p);
+           return NULL;
+          }
+        p->w[i].slot[s] = mem;
+       }
+ for(i=0; i<nthreads; i++)
+    {w = &p->w[i];
+     if(pthread_create(&w->tid, NULL, worker_main, w) != 0)
+       {randpar_stop(p);
+        return NULL;
+       }
+     w->started = 1;
+    }
+ return p;
+}
+
+const uint64_t *randpar_next(randpar *p)
+{struct worker *w;
+ uint64_t k;
+ int s;
+
+ if(p->held)
+   {/* give block k-1 back to its thread */
+    k = p->k - 1;
+    w = &p->w[k % (uint64_t)p->nthreads];
+    s = (int)(k / (uint64_t)p->nthreads % NSLOTS);
+    pthread_mutex_lock(&w->m);
+    w->full[s] = 0;
+    pthread_cond_broadcast(&w->c);
+    pthread_mutex_unlock(&w->m);
+   }
+
+ k = p->k;
+ w = &p->w[k % (uint64_t)p->nthreads];
+ s = (int)(k / (uint64_t)p->nthreads % NSLOTS);
+ pthread_mutex_lock(&w->m);
+ while(!w->full[s]) pthread_cond_wait(&w->c, &w->m);
+ pthread_mutex_unlock(&w->m);
+ p->k++;
+ p->held = 1;
+ return w->slot[s];
+}
+
+void randpar_stop(randpar *p)
+{struct worker *w;
+ int i, s;
+
+ for(i=0; i<p->nthreads; i++)
+    {w = &p->w[i];
+     pthread_mutex_lock(&w->m);
+     w->stop = 1;
+     pthread_cond_broadcast(&w->c);
+     pthread_mutex_unlock(&w->m);
+    }
+ for(i=0; i<p->nthreads; i++)
+    {w = &p->w[i];
+     if(w->started) pthread_join(w->tid, NULL);
+     for(s=0; s<NSLOTS; s++) free(w->slot[s]);
+     pthread_mutex_destroy(&w->m);
+     pthread_cond_destroy(&w->c);
+    }
+ free(p->w);
+ free(p);
+}
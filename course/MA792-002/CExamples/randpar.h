@@ -0,0 +1,29 @@
+/* File: CExamples/randpar.h
+   Parallel generation of one reproducible bit stream.
+   Thread i runs the xoshiro256** generator seeded with seed and then
+   jumped i times (xoshiro256_jump), and fills blocks of block_words
+   words.  The blocks are handed out round robin, thread 0, 1, ...,
+   nthreads-1, 0, 1, ..., so that the same seed, thread count and block
+   size always give the same stream, however the threads are scheduled.
+   With one thread the stream is the plain xoshiro256_fill stream.
+   Link with -pthread. */
+
+#ifndef RANDPAR_H
+#define RANDPAR_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef struct randpar randpar;
+
+/* start nthreads generator threads; return NULL if out of resources */
+randpar *randpar_start(uint64_t seed, int nthreads, size_t block_words);
+
+/* return the next block of the stream; it stays valid until the next
+   call of randpar_next or randpar_stop */
+const uint64_t *randpar_next(randpar *p);
+
+/* stop the threads and free p */
+void randpar_stop(randpar *p);
+
+#endif /* RANDPAR_H */
@@ -0,0 +1,349 @@
+/* File: CExamples/randtest.c
+   Statistical quality and speed of the random bit generators used by
+   rand.c and rand2.c.  Each engine's packed 64-bit words go straight
+   into streaming tests (after NIST SP 800-22), with no text in between:
+
+     monobit          proportion of ones
+     runs             number of runs of equal bits
+     serial           overlapping 2-bit patterns (two statistics)
+     poker            non-overlapping 4-bit patterns
+     block frequency  ones in blocks of 128 bits
+     spectral         peaks of the DFT, on the first SPEC_BLOCKS blocks
+                      of SPEC_N bits (the FFT is far slower than the rest)
+
+   For each test a p-value is printed; values below 0.01 (or piled up
+   near 1) suggest a bad generator.  Speed is reported twice: the engine
+   alone, and the engine together with all tests.
+
+   Run as "randtest [-n <MB>] [-s <seed>] [-j <threads>]"
+   Compile as "gcc -Wall -std=c99 -O2 -march=native -pthread randtest.c randpar.c -lm" */
+
+#define _POSIX_C_SOURCE 200112L /* for clock_gettime */
+#define _XOPEN_SOURCE 600       /* for M_PI */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "xoshiro.h"
+#include "randpar.h"
+
+#define BLOCK (1 << 16)  /* words handed out by an engine at a time */
+#define SPEC_N 4096      /* bits per spectral test block */
+#define SPEC_BLOCKS 256  /* blocks of the spectral test */
+
+/* ---------- engines ---------- */
+
+/* an engine gives BLOCK words per call of next; slow engines are only
+   run on the first maxmb MB */
+typedef struct {
+  const char *name;
+  long maxmb;
+  void (*start)(uint64_t seed, int nthreads);
+  const uint64_t *(*next)(void);
+  void (*stop)(void);
+} engine;
+
+static uint64_t engine_buf[BLOCK];
+static xoshiro256 engine_g;
+static randpar *engine_par;
+
+/* the old rand.c stream: the low bit of rand(), 64 calls per word */
+static void libc_start(uint64_t seed, int nthreads)
+{(void)nthreads; srand((unsigned)seed);}
+
+static const uint64_t *libc_next(void)
+{int i, b;
+ for(i=0; i<BLOCK; i++)
+    {engine_buf[i] = 0;
+     for(b=0; b<64; b++) engine_buf[i] |= (uint64_t)(1 & rand()) << b;
+    }
+ return engine_buf;
+}
+
+static void xoshiro_start(uint64_t seed, int nthreads)
+{(void)nthreads; xoshiro256_seed(&engine_g, seed);}
+
+static const uint64_t *xoshiro_next(void)
+{xoshiro256_fill(&engine_g, engine_buf, BLOCK);
+ return engine_buf;
+}
+
+static void par_start(uint64_t seed, int nthreads)
+{engine_par = randpar_start(seed, nthreads, BLOCK);
+ if(engine_par == NULL)
+   {fprintf(stderr, "Cannot start %d threads\n", nthreads);
+    exit(1);
+   }
+}
+
+static const uint64_t *par_next(void) {return randpar_next(engine_par);}
+
+static void par_stop(void) {randpar_stop(engine_par);}
+
+static void no_stop(void) {}
+
+static engine engines[] = {
+  {"libc rand()&1",   16, libc_start,    libc_next,    no_stop},
+  {"xoshiro256**",     0, xoshiro_start, xoshiro_next, no_stop},
+  {"xoshiro256** -j",  0, par_start,     par_next,     par_stop},
+};
+#define NENGINES (int)(sizeof(engines) / sizeof(engines[0]))
+
+/* ---------- special functions ---------- */
+
+/* regularized upper incomplete gamma function Q(a,x), as in
+   Numerical Recipes; for very large a the Wilson-Hilferty normal
+   approximation of the chi-square distribution is used instead */
+static double igamc(double a, double x)
+{double sum, del, ap, b, c, d, h, an, t, z;
+ int i;
+ if(x <= 0) return 1.0;
+ if(a > 1e5)
+   {t = 1.0 / (9*a);
+    z = (pow(x/a, 1.0/3) - (1 - t)) / sqrt(t);
+    return 0.5 * erfc(z / sqrt(2.0));
+   }
+ if(x < a + 1)
+   {/* series for P(a,x) */
+    ap = a; sum = del = 1.0/a;
+    for(i=0; i<100000; i++)
+       {ap += 1; del *= x/ap; sum += del;
+        if(fabs(del) < fabs(sum) * 1e-15) break;
+       }
+    return 1.0 - sum * exp(-x + a*log(x) - lgamma(a));
+   }
+ /* continued fraction for Q(a,x) */
+ b = x + 1 - a; c = 1.0/1e-300; d = 1.0/b; h = d;
+ for(i=1; i<100000; i++)
+    {an = -i * (i - a); b += 2;
+     d = an*d + b; if(fabs(d) < 1e-300) d = 1e-300;
+     c = b + an/c; if(fabs(c) < 1e-300) c = 1e-300;
+     d = 1.0/d; del = d*c; h *= del;
+     if(fabs(del - 1.0) < 1e-15) break;
+    }
+ return exp(-x + a*log(x) - lgamma(a)) * h;
+}
+
+/* in-place radix-2 FFT of re[0..n-1], im[0..n-1], n = SPEC_N */
+static void fft(double *re, double *im, int n)
+{static double cw[SPEC_N/2], sw[SPEC_N/2]; /* exp(-2 pi i k/n) */
+ static int have_twiddles = 0;
+ int i, j, k, len, step;
+ double t, wr, wi, ur, ui, xr, xi;
+ if(!have_twiddles)
+   {for(k=0; k<n/2; k++)
+       {cw[k] = cos(-2*M_PI*k/n);
+        sw[k] = sin(-2*M_PI*k/n);
+       }
+    have_twiddles = 1;
+   }
+ for(i=1, j=0; i<n; i++)
+    {for(k=n>>1; j & k; k >>= 1) j ^= k;
+     j ^= k;
+     if(i < j)
+       {t = re[i]; re[i] = re[j]; re[j] = t;
+        t = im[i]; im[i] = im[j]; im[j] = t;
+       }
+    }
+ for(len=2; len<=n; len <<= 1)
+    {step = n/len;
+     for(i=0; i<n; i+=len)
+        for(k=0; k<len/2; k++)
+           {wr = cw[k*step]; wi = sw[k*step];
+            xr = re[i+k+len/2]; xi = im[i+k+len/2];
+            ur = xr*wr - xi*wi; ui = xr*wi + xi*wr;
+            re[i+k+len/2] = re[i+k] - ur; im[i+k+len/2] = im[i+k] - ui;
+            re[i+k] += ur; im[i+k] += ui;
+           }
+    }
+}
+
+/* ---------- streaming tests ---------- */
+
+typedef struct {
+  uint64_t n;          /* bits seen */
+  uint64_t ones;
+  uint64_t trans;      /* neighbouring bits that differ */
+  uint64_t pairs11;    /* overlapping "11" pairs */
+  uint64_t bytes[256]; /* byte histogram, for the poker test */
+  double blockchi;     /* sum over 128-bit blocks of (ones/128 - 1/2)^2 */
+  uint64_t nblocks;
+  uint64_t first, last;
+  double spec_n0, spec_n1;
+  int spec_blocks;
+  double spec_re[SPEC_N], spec_im[SPEC_N];
+} stats;
+
+static void stats_words(stats *st, const uint64_t *w, size_t n)
+{size_t i;
+ int j, c;
+ uint64_t x, last, ones = 0, trans = 0, pairs11 = 0;
+ uint32_t bytes[4][256]; /* four tables, so that equal bytes rarely collide */
+ double blockchi = 0, T;
+
+ /* the counts are kept in locals: w and st's fields are both uint64_t,
+    so the compiler could not keep st's fields in registers */
+ if(n == 0) return;
+ memset(bytes, 0, sizeof(bytes));
+ if(st->n == 0) st->first = last = w[0];
+ else last = st->last;
+ for(i=0; i<n; i++)
+    {x = w[i];
+     ones += (uint64_t)__builtin_popcountll(x);
+     /* pairs inside the word, then the pair across the word boundary */
+     trans += (uint64_t)__builtin_popcountll((x ^ (x >> 1)) & 0x7fffffffffffffffULL);
+     pairs11 += (uint64_t)__builtin_popcountll(x & (x >> 1));
+     if(st->n > 0 || i > 0)
+       {trans += ((last >> 63) ^ x) & 1;
+        pairs11 += (last >> 63) & x & 1;
+       }
+     last = x;
+     bytes[0][x & 255]++;         bytes[1][(x >> 8) & 255]++;
+     bytes[2][(x >> 16) & 255]++; bytes[3][(x >> 24) & 255]++;
+     bytes[0][(x >> 32) & 255]++; bytes[1][(x >> 40) & 255]++;
+     bytes[2][(x >> 48) & 255]++; bytes[3][x >> 56]++;
+     if(i & 1)
+       {c = __builtin_popcountll(w[i-1]) + __builtin_popcountll(x);
+        blockchi += (c - 64) * (c - 64);
+       }
+    }
+ for(j=0; j<256; j++)
+    st->bytes[j] += (uint64_t)bytes[0][j] + bytes[1][j] + bytes[2][j] + bytes[3][j];
+ st->ones += ones;
+ st->trans += trans;
+ st->pairs11 += pairs11;
+ st->last = last;
+ st->blockchi += blockchi / (128.0*128.0);
+ st->nblocks += n / 2;
+
+ /* spectral test on whole SPEC_N-bit blocks at the start of w */
+ for(i=0; st->spec_blocks < SPEC_BLOCKS && i + SPEC_N/64 <= n; i += SPEC_N/64)
+    {for(j=0; j<SPEC_N; j++)
+        {st->spec_re[j] = ((w[i + j/64] >> (j%64)) & 1) ? 1.0 : -1.0;
+         st->spec_im[j] = 0;
+        }
+     fft(st->spec_re, st->spec_im, SPEC_N);
+     T = log(1/0.05) * SPEC_N; /* the threshold, squared */
+     for(j=0; j<SPEC_N/2; j++)
+        if(st->spec_re[j]*st->spec_re[j] + st->spec_im[j]*st->spec_im[j] < T)
+           st->spec_n1++;
+     st->spec_n0 += 0.95 * SPEC_N / 2;
+     st->spec_blocks++;
+    }
+ st->n += 64 * (uint64_t)n;
+}
+
+static void stats_report(stats *st)
+{double n = (double)st->n, pi, v, s, psi2, psi1, d, chi;
+ double n11, n10, n00, poker[16];
+ int i;
+
+ /* close the cycle for the serial test */
+ st->pairs11 += (st->last >> 63) & st->first & 1;
+
+ s = 2.0*st->ones - n;
+ printf("  monobit          p = %.4f\n", erfc(fabs(s) / sqrt(2*n)));
+
+ pi = st->ones / n;
+ if(fabs(pi - 0.5) >= 2 / sqrt(n))
+    printf("  runs             p = 0.0000 (monobit failed)\n");
+ else
+   {v = st->trans + 1.0;
+    printf("  runs             p = %.4f\n",
+           erfc(fabs(v - 2*n*pi*(1-pi)) / (2*sqrt(2*n)*pi*(1-pi))));
+   }
+
+ /* cyclic overlapping pairs: "10" and "01" are as frequent */
+ n11 = (double)st->pairs11;
+ n10 = st->ones - n11;
+ n00 = n - st->ones - n10;
+ psi2 = 4/n * (n00*n00 + 2*n10*n10 + n11*n11) - n;
+ psi1 = 2/n * ((n - st->ones)*(n - st->ones) + (double)st->ones*st->ones) - n;
+ printf("  serial           p = %.4f, %.4f\n",
+        igamc(1.0, (psi2 - psi1)/2), igamc(0.5, (psi2 - 2*psi1)/2));
+
+ /* each byte holds two nibbles */
+ for(i=0; i<16; i++) poker[i] = 0;
+ for(i=0; i<256; i++)
+    {poker[i & 15] += st->bytes[i];
+     poker[i >> 4] += st->bytes[i];
+    }
+ d = n / 4;
+ chi = 0;
+ for(i=0; i<16; i++) chi += poker[i] * poker[i];
+ chi = 16/d * chi - d;
+ printf("  poker            p = %.4f\n", igamc(7.5, chi/2));
+
+ chi = 4*128 * st->blockchi;
+ printf("  block frequency  p = %.4f\n", igamc(st->nblocks/2.0, chi/2));
+
+ d = (st->spec_n1 - st->spec_n0)
+     / sqrt(st->spec_blocks * SPEC_N * 0.95 * 0.05 / 4);
+ printf("  spectral         p = %.4f\n", erfc(fabs(d) / sqrt(2.0)));
+}
+
+/* ---------- driver ---------- */
+
+static double now(void)
+{struct timespec ts;
+ clock_gettime(CLOCK_MONOTONIC, &ts);
+ return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+int main(int argc, char* argv[])
+{int i, e, nthreads = 4;
+ long mb = 256, maxblocks, nblocks, k;
+ uint64_t seed = 101;
+ double t, gen, all;
+ volatile uint64_t sink = 0;
+ const uint64_t *w;
+ stats *st;
+
+ for(i=1; i<argc; i++)
+    if(strcmp(argv[i], "-n") == 0 && i+1 < argc) mb = atol(argv[++i]);
+    else if(strcmp(argv[i], "-s") == 0 && i+1 < argc) seed = strtoull(argv[++i], NULL, 10);
+    else if(strcmp(argv[i], "-j") == 0 && i+1 < argc) nthreads = atoi(argv[++i]);
+    else
+      {fprintf(stderr, "Error, call: %s [-n <MB>] [-s <seed>] [-j <threads>]\n", argv[0]);
+       return 1;
+      }
+ maxblocks = (mb * (1L << 20) + 8*BLOCK - 1) / (8*BLOCK);
+ if(maxblocks < 1) maxblocks = 1;
+ st = malloc(sizeof(stats));
+ if(st == NULL) return 1;
+
+ printf("seed %llu\n", (unsigned long long)seed);
+ for(e=0; e<NENGINES; e++)
+    {nblocks = maxblocks;
+     if(engines[e].maxmb > 0 && nblocks > engines[e].maxmb * (1L << 20) / (8*BLOCK))
+        nblocks = engines[e].maxmb * (1L << 20) / (8*BLOCK);
+
+     /* the engine alone */
+     engines[e].start(seed, nthreads);
+     t = now();
+     for(k=0; k<nblocks; k++) sink ^= engines[e].next()[BLOCK-1];
+     gen = now() - t;
+     engines[e].stop();
+
+     /* the same stream again, through the tests */
+     memset(st, 0, sizeof(stats));
+     engines[e].start(seed, nthreads);
+     t = now();
+     for(k=0; k<nblocks; k++)
+        {w = engines[e].next();
+         stats_words(st, w, BLOCK);
+        }
+     all = now() - t;
+     engines[e].stop();
+
+     printf("%s", engines[e].name);
+     if(engines[e].stop == par_stop) printf(" %d", nthreads);
+     printf(", %ld MB: %.3f GB/s alone, %.3f GB/s with tests\n",
+            nblocks * 8*BLOCK >> 20,
+            8.0*BLOCK*nblocks / gen * 1e-9, 8.0*BLOCK*nblocks / all * 1e-9);
+     stats_report(st);
+    }
+ free(st);
+ return (int)(sink & 0);
+}
@@ -0,0 +1,186 @@
+/* File: CExamples/sample.c
+   Random variates in batches; see sample.h.
+   Compile with the program using it, e.g.
+              "gcc -Wall -std=c99 -O2 -march=native samplers.c sample.c -lm" */
+
+#define _POSIX_C_SOURCE 200112L /* for pthread_once */
+#include <math.h>
+#include <pthread.h>
+#include "sample.h"
+
+#define CHUNK 256 /* uniform words drawn at a time */
+
+/* uniform on (0,1) from the top 53 bits of a word */
+#define U01(w) (((double)((w) >> 11) + 0.5) * (1.0 / 9007199254740992.0))
+
+/* ---------- normal: ziggurat with 128 boxes ---------- */
+
+#define ZIG_C 128
+#define ZIG_R 3.442619855899           /* start of the tail */
+#define ZIG_V 9.91256303526217e-3      /* area of each box */
+
+static double zig_x[ZIG_C + 1], zig_r[ZIG_C];
+static pthread_once_t zig_once = PTHREAD_ONCE_INIT;
+
+static void zig_init(void)
+{double f;
+ int i;
+ f = exp(-0.5 * ZIG_R * ZIG_R);
+ zig_x[0] = ZIG_V / f; /* the bottom box, including the tail */
+ zig_x[1] = ZIG_R;
+ zig_x[ZIG_C] = 0;
+ for(i=2; i<ZIG_C; i++)
+    {zig_x[i] = sqrt(-2 * log(ZIG_V / zig_x[i-1] + f));
+     f = exp(-0.5 * zig_x[i] * zig_x[i]);
+    }
+ for(i=0; i<ZIG_C; i++) zig_r[i] = zig_x[i+1] / zig_x[i];
+}
+
+/* the rare cases of the ziggurat: wedges and tail, for the word w
+   that missed the rectangle of box i */
+static double zig_slow(xoshiro256 *g, uint64_t w)
+{int i;
+ double u, x, y, f0, f1;
+ for(;;)
+    {i = (int)(w & (ZIG_C - 1));
+     u = 2 * U01(w) - 1;
+     if(fabs(u) < zig_r[i]) return u * zig_x[i];
+     if(i == 0)
+       {/* the tail beyond ZIG_R */
+        do {x = log(U01(xoshiro256_next(g))) / ZIG_R;
+            y = log(U01(xoshiro256_next(g)));
+           } while(-2 * y < x * x);
+        return u < 0 ? x - ZIG_R : ZIG_R - x;
+       }
+     x = u * zig_x[i];
+     f0 = exp(-0.5 * (zig_x[i] * zig_x[i] - x * x));
+     f1 = exp(-0.5 * (zig_x[i+1] * zig_x[i+1] - x * x));
+     if(f1 + U01(xoshiro256_next(g)) * (f0 - f1) < 1.0) return x;
+     w = xoshiro256_next(g);
+    }
+}
+
+void sample_normal(xoshiro256 *g, double *x, size_t n, double mu, double sigma)
+{uint64_t w[CHUNK];
+ size_t i, j, m;
+ double u;
+ int b;
+
+ pthread_once(&zig_once, zig_init);
+ for(i=0; i<n; i+=m)
+    {m = n - i < CHUNK ? n - i : CHUNK;
+     xoshiro256_fill(g, w, m);
+     /* the low 7 bits pick the box, the top 53 the point in it;
+        about 99% of the words land inside the box's rectangle */
+     for(j=0; j<m; j++)
+        {b = (int)(w[j] & (ZIG_C - 1));
+         u = 2 * U01(w[j]) - 1;
+         if(fabs(u) < zig_r[b]) x[i+j] = mu + sigma * (u * zig_x[b]);
+         else x[i+j] = mu + sigma * zig_slow(g, w[j]);
+        }
+    }
+}
+
+void sample_uniform(xoshiro256 *g, double *x, size_t n)
+{uint64_t w[CHUNK];
+ size_t i, j, m;
+ for(i=0; i<n; i+=m)
+    {m = n - i < CHUNK ? n - i : CHUNK;
+     xoshiro256_fill(g, w, m);
+     for(j=0; j<m; j++) x[i+j] = U01(w[j]);
+    }
+}
+
+/* ---------- binomial ---------- */
+
+/* BTRS of W. Hoermann (1993), "The generation of binomial random
+   variates", for size*p >= 10 and p <= 1/2 */
+static int binomial_btrs(xoshiro256 *g, int size, double p)
+{double q = 1 - p, spq = sqrt(size * p * q);
+ double b = 1.15 + 2.53 * spq;
+ double a = -0.0873 + 0.0248 * b + 0.01 * p;
+ double c = size * p + 0.5;
+ double vr = 0.92 - 4.2 / b;
+ double alpha = (2.83 + 5.1 / b) * spq;
+ double lpq = log(p / q);
+ int m = (int)floor((size + 1) * p);
+ double h = lgamma(m + 1.0) + lgamma(size - m + 1.0);
+ double u, v, us;
+ int k;
+ for(;;)
+    {u = U01(xoshiro256_next(g)) - 0.5;
+     v = U01(xoshiro256_next(g));
+     us = 0.5 - fabs(u);
+     k = (int)floor((2 * a / us + b) * u + c);
+     if(k < 0 || k > size) continue;
+     if(us >= 0.07 && v <= vr) return k;
+     v = log(v * alpha / (a / (us * us) + b));
+     if(v <= h - lgamma(k + 1.0) - lgamma(size - k + 1.0) + (k - m) * lpq)
+        return k;
+    }
+}
+
+void sample_binomial(xoshiro256 *g, int *k, size_t n, int size, double p)
+{uint64_t w[CHUNK];
+ size_t i, j, m;
+ int flip = 0, r;
+ double q, s, f, u, pk;
+
+ if(p > 0.5) {p = 1 - p; flip = size;}
+ if(size <= 0 || p <= 0)
+   {for(i=0; i<n; i++) k[i] = flip;
+    return;
+   }
+ if(size == 1)
+   {/* Bernoulli: one comparison per word */
+    for(i=0; i<n; i+=m)
+       {m = n - i < CHUNK ? n - i : CHUNK;
+        xoshiro256_fill(g, w, m);
+        for(j=0; j<m; j++) k[i+j] = flip ? U01(w[j]) >= p : U01(w[j]) < p;
+       }
+    return;
+   }
+ if(size * p >= 10)
+   {for(i=0; i<n; i++)
+       {r = binomial_btrs(g, size, p);
+        k[i] = flip ? size - r : r;
+       }
+    return;
+   }
+
+ /* inversion: walk up the distribution function from 0 */
+ q = 1 - p;
+ s = p / q;
+ f = pow(q, size);
+ for(i=0; i<n; i+=m)
+    {m = n - i < CHUNK ? n - i : CHUNK;
+     xoshiro256_fill(g, w, m);
+     for(j=0; j<m; j++)
+        {u = U01(w[j]);
+         pk = f;
+         for(r=0; u > pk && r < size; r++)
+            {u -= pk;
+             pk *= s * (size - r) / (r + 1);
+            }
+         k[i+j] = flip ? size - r : r;
+        }
+    }
+}
+
+/* ---------- Bernoulli with logit probabilities ---------- */
+
+void sample_bernoulli_logit(xoshiro256 *g, int *c, double *prob,
+                            const double *eta, size_t n)
+{uint64_t w[CHUNK];
+ double pr[CHUNK];
+ size_t i, j, m;
+ for(i=0; i<n; i+=m)
+    {m = n - i < CHUNK ? n - i : CHUNK;
+     xoshiro256_fill(g, w, m);
+     /* two plain loops, so that the compiler can vectorize the first */
+     for(j=0; j<m; j++) pr[j] = 1 / (1 + exp(-eta[i+j]));
+     for(j=0; j<m; j++) c[i+j] = U01(w[j]) < pr[j];
+     if(prob != NULL)
+        for(j=0; j<m; j++) prob[i+j] = pr[j];
+    }
+}
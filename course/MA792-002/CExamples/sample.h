@@ -0,0 +1,39 @@
+/* File: CExamples/sample.h
+   Random variates in batches, from the xoshiro256** generator of
+   xoshiro.h: each routine fills a whole array, taking its uniforms a
+   block of words at a time.  These are the rnorm/rbinom calls of the
+   simulation scripts such as st790_missing/examples/mean_sim.R.
+   Needs C99; link with sample.c and -lm. */
+
+#ifndef SAMPLE_H
+#define SAMPLE_H
+
+#include <stddef.h>
+#include "xoshiro.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* x[i] uniform on (0,1), never 0 or 1 */
+void sample_uniform(xoshiro256 *g, double *x, size_t n);
+
+/* x[i] normal with mean mu and standard deviation sigma
+   (ziggurat method of Marsaglia and Tsang, in Doornik's form) */
+void sample_normal(xoshiro256 *g, double *x, size_t n, double mu, double sigma);
+
+/* k[i] binomial(size, p): inversion when size*min(p,1-p) < 10, else
+   Hoermann's transformed rejection (BTRS) */
+void sample_binomial(xoshiro256 *g, int *k, size_t n, int size, double p);
+
+/* c[i] = 1 with probability 1/(1+exp(-eta[i])), else 0; if prob is
+   not NULL the probabilities are stored there too (as pifunc in
+   mean_sim.R) */
+void sample_bernoulli_logit(xoshiro256 *g, int *c, double *prob,
+                            const double *eta, size_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SAMPLE_H */
@@ -0,0 +1,93 @@
+/* File: CExamples/samplers.c
+   Checks and times the batch samplers of sample.c: prints the sample
+   mean and variance of each distribution next to the exact ones, and
+   the speed in millions of variates per second.
+   Run as "samplers [<n>] [<seed>]"
+   Compile as "gcc -Wall -std=c99 -O2 -march=native -pthread samplers.c sample.c -lm" */
+#define _POSIX_C_SOURCE 200112L /* for clock_gettime */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include "sample.h"
+
+double now(void)
+{struct timespec ts;
+ clock_gettime(CLOCK_MONOTONIC, &ts);
+ return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+/* print mean and variance of x[0..n-1] against the exact values */
+void report(const char *name, const double *x, size_t n,
+            double mean, double var, double seconds)
+{size_t i;
+ double s = 0, ss = 0, m;
+ for(i=0; i<n; i++) s += x[i];
+ m = s / n;
+ for(i=0; i<n; i++) ss += (x[i] - m) * (x[i] - m);
+ printf("%-22s mean %9.5f (%9.5f)  var %9.5f (%9.5f)  %7.1f M/s\n",
+        name, m, mean, ss / (n - 1), var, n / seconds * 1e-6);
+}
+
+int main(int argc, char* argv[])
+{size_t n = 10000000, i;
+ unsigned long seed = 4;
+ double *x, *eta, *prob, t, pbar;
+ int *k, j;
+ xoshiro256 g;
+ static const struct {int size; double p;} binom[] =
+   {{1, 0.5}, {20, 0.3}, {1000, 0.4}, {100000, 0.9}};
+ char name[40];
+
+ if(argc > 1) n = strtoul(argv[1], NULL, 10);
+ if(argc > 2) seed = strtoul(argv[2], NULL, 10);
+ x = malloc(n * sizeof(double));
+ eta = malloc(n * sizeof(double));
+ prob = malloc(n * sizeof(double));
+ k = malloc(n * sizeof(int));
+ if(n < 2 || x == NULL || eta == NULL || prob == NULL || k == NULL)
+   {fprintf(stderr, "Error, call: %s [<n> >= 2] [<seed>]\n", argv[0]);
+    return 1;
+   }
+ /* touch the pages, so that the first timing does not include that */
+ memset(x, 0, n * sizeof(double));
+ memset(k, 0, n * sizeof(int));
+ xoshiro256_seed(&g, seed);
+
+ t = now();
+ sample_uniform(&g, x, n);
+ report("uniform(0,1)", x, n, 0.5, 1.0/12, now() - t);
+
+ t = now();
+ sample_normal(&g, x, n, 0, 1);
+ report("normal(0,1)", x, n, 0, 1, now() - t);
+
+ t = now();
+ sample_normal(&g, x, n, 2.3, 0.5);
+ report("normal(2.3,0.5)", x, n, 2.3, 0.25, now() - t);
+
+ for(j=0; j<(int)(sizeof(binom)/sizeof(binom[0])); j++)
+    {t = now();
+     sample_binomial(&g, k, n, binom[j].size, binom[j].p);
+     t = now() - t;
+     for(i=0; i<n; i++) x[i] = k[i];
+     sprintf(name, "binomial(%d,%.1f)", binom[j].size, binom[j].p);
+     report(name, x, n, binom[j].size * binom[j].p,
+            binom[j].size * binom[j].p * (1 - binom[j].p), t);
+    }
+
+ /* missingness indicators as in mean_sim.R: logit(pi) = 0.8 - 1.4 v1 */
+ sample_normal(&g, eta, n, 0, 1);
+ for(i=0; i<n; i++) eta[i] = 0.8 - 1.4 * eta[i];
+ t = now();
+ sample_bernoulli_logit(&g, k, prob, eta, n);
+ t = now() - t;
+ pbar = 0;
+ for(i=0; i<n; i++) {x[i] = k[i]; pbar += prob[i];}
+ pbar /= n;
+ report("bernoulli(logit eta)", x, n, pbar, pbar * (1 - pbar), t);
+
+ free(x); free(eta); free(prob); free(k);
+ return 0;
+}
@@ -0,0 +1,169 @@
+/* File: CExamples/txt2mat.c
+   Converts a text matrix, one row per line of numbers separated by
+   blanks, with "NA" or "." for missing values (as bvnormal.dat and
+   cd4.dat of the statistics courses), into a binary file of
+   matfile.h; missing values become NaN.
+   Run as "txt2mat [-f] in.dat out.mat" (-f for float, else double),
+   and as "txt2mat -i out.mat" to map a binary file and print its
+   shape and column means.
+   Compile as "gcc -Wall -std=c99 -O2 txt2mat.c matfile.c matrix.c" */
+
+#define _POSIX_C_SOURCE 200112L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include "matfile.h"
+
+static int is_blank(char c)
+{return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+/* the whole file in a buffer ended by '\0'; NULL on error */
+static char *slurp(const char *name, size_t *len)
+{FILE *in = fopen(name, "rb");
+ char *buf = NULL, *nb;
+ size_t cap = 0, n = 0, r;
+ if(in == NULL) return NULL;
+ do {if(n + 1 >= cap)
+       {cap = cap ? 2 * cap : 1 << 16;
+        nb = realloc(buf, cap);
+        if(nb == NULL)
+          {free(buf);
+           fclose(in);
+           return NULL;
+          }
+        buf = nb;
+       }
+     r = fread(buf + n, 1, cap - n - 1, in);
+     n += r;
+    } while(r > 0);
+ fclose(in);
+ buf[n] = '\0';
+ *len = n;
+ return buf;
+}
+
+/* the fields of the line at p (up to '\n' or the end) */
+static size_t fields(const char *p)
+{size_t n = 0;
+ while(*p != '\0' && *p != '\n')
+   {while(is_blank(*p)) p++;
+    if(*p == '\0' || *p == '\n') break;
+    n++;
+    while(*p != '\0' && *p != '\n' && !is_blank(*p)) p++;
+   }
+ return n;
+}
+
+static int convert(const char *from, const char *to, int dtype)
+{char *buf, *p, *e;
+ size_t len, rows = 0, cols = 0, line = 0, i, j, n;
+ matrix m;
+ double v;
+
+ buf = slurp(from, &len);
+ if(buf == NULL)
+   {perror(from);
+    return 1;
+   }
+ /* count the rows, and check that each has as many fields as the first */
+ for(p=buf; *p != '\0'; p++)
+    {line++;
+     n = fields(p);
+     if(n > 0)
+       {if(rows == 0) cols = n;
+        else if(n != cols)
+          {fprintf(stderr, "%s:%lu: %lu numbers, not %lu\n", from,
+                   (unsigned long)line, (unsigned long)n, (unsigned long)cols);
+           return 1;
+          }
+        rows++;
+       }
+     p = strchr(p, '\n');
+     if(p == NULL) break;
+    }
+ if(matrix_alloc(&m, dtype, rows, cols) != 0)
+   {fprintf(stderr, "Out of memory\n");
+    return 1;
+   }
+ /* one line each time round, as in the first pass */
+ for(p=buf, i=0, line=1; i<rows; line++)
+    {if(fields(p) == 0)
+       {p = strchr(p, '\n') + 1; /* a blank line is never the last */
+        continue;
+       }
+     for(j=0; j<cols; j++)
+        {while(is_blank(*p)) p++;
+         if((p[0] == 'N' && p[1] == 'A') || p[0] == '.')
+           e = p + (p[0] == 'N' ? 2 : 1);
+         else e = NULL;
+         if(e != NULL && (*e == '\0' || *e == '\n' || is_blank(*e)))
+           v = NAN;
+         else
+           {v = strtod(p, &e);
+            if(e == p || !(*e == '\0' || *e == '\n' || is_blank(*e)))
+              {fprintf(stderr, "%s:%lu: not a number in column %lu\n", from,
+                       (unsigned long)line, (unsigned long)j + 1);
+               return 1;
+              }
+           }
+         if(dtype == MATRIX_FLOAT) MATRIX_F(&m, i, j) = (float)v;
+         else MATRIX_D(&m, i, j) = v;
+         p = e;
+        }
+     i++;
+     p = strchr(p, '\n');
+     if(p == NULL) break;
+     p++;
+    }
+ free(buf);
+ if(matfile_write(to, &m) != 0)
+   {perror(to);
+    return 1;
+   }
+ printf("%s: %lu x %lu %s\n", to, (unsigned long)rows, (unsigned long)cols,
+        dtype == MATRIX_FLOAT ? "float" : "double");
+ matrix_free(&m);
+ return 0;
+}
+
+static int info(const char *name)
+{matfile f;
+ size_t i, j, n;
+ double s, v;
+
+ if(matfile_open(&f, name) != 0)
+   {perror(name);
+    return 1;
+   }
+ printf("%s: %lu x %lu %s, stride %lu\n", name, (unsigned long)f.m.rows,
+        (unsigned long)f.m.cols, f.m.dtype == MATRIX_FLOAT ? "float" : "double",
+        (unsigned long)f.m.stride);
+ for(j=0; j<f.m.cols; j++)
+    {s = 0;
+     n = 0;
+     for(i=0; i<f.m.rows; i++)
+        {v = f.m.dtype == MATRIX_FLOAT ? MATRIX_F(&f.m, i, j) : MATRIX_D(&f.m, i, j);
+         if(!isnan(v))
+           {s += v;
+            n++;
+           }
+        }
+     printf("column %lu: %lu NA, mean %g\n", (unsigned long)j + 1,
+            (unsigned long)(f.m.rows - n), n > 0 ? s / n : NAN);
+    }
+ matfile_close(&f);
+ return 0;
+}
+
+int main(int argc, char **argv)
+{if(argc == 3 && strcmp(argv[1], "-i") == 0) return info(argv[2]);
+ if(argc == 3) return convert(argv[1], argv[2], MATRIX_DOUBLE);
+ if(argc == 4 && strcmp(argv[1], "-f") == 0)
+   return convert(argv[2], argv[3], MATRIX_FLOAT);
+ fprintf(stderr, "usage: %s [-f] in.dat out.mat\n"
+                 "       %s -i out.mat\n", argv[0], argv[0]);
+ return 1;
+}
@@ -0,0 +1,71 @@
+/* File: CExamples/xoshiro.h
+   The xoshiro256** generator of Blackman and Vigna (2018).
+   Every call gives 64 good bits, against the 1 low bit of rand() that
+   rand.c used to keep, and takes about a nanosecond.
+   The state is seeded from a single integer through splitmix64, as the
+   authors recommend.  Needs C99 (compile with -std=c99). */
+
+#ifndef XOSHIRO_H
+#define XOSHIRO_H
+
+#include <stdint.h>
+#include <stddef.h> /* for size_t */
+
+typedef struct {uint64_t s[4];} xoshiro256;
+
+static inline uint64_t xoshiro_rotl(uint64_t x, int k)
+{return (x << k) | (x >> (64 - k));}
+
+/* advance *x and return the next splitmix64 output */
+static inline uint64_t splitmix64(uint64_t *x)
+{uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+ z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+ z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+ return z ^ (z >> 31);
+}
+
+static inline void xoshiro256_seed(xoshiro256 *g, uint64_t seed)
+{int i;
+ for(i=0; i<4; i++) g->s[i] = splitmix64(&seed);
+}
+
+static inline uint64_t xoshiro256_next(xoshiro256 *g)
+{uint64_t *s = g->s;
+ uint64_t result = xoshiro_rotl(s[1] * 5, 7) * 9;
+ uint64_t t = s[1] << 17;
+ s[2] ^= s[0];
+ s[3] ^= s[1];
+ s[1] ^= s[2];
+ s[0] ^= s[3];
+ s[2] ^= t;
+ s[3] = xoshiro_rotl(s[3], 45);
+ return result;
+}
+
+/* fill buf[0..n-1] with packed random bits; the state is kept in
+   registers for the whole loop */
+static inline void xoshiro256_fill(xoshiro256 *g, uint64_t *buf, size_t n)
+{xoshiro256 h = *g;
+ size_t i;
+ for(i=0; i<n; i++) buf[i] = xoshiro256_next(&h);
+ *g = h;
+}
+
+/* advance g by 2^128 steps, as if 2^128 calls to xoshiro256_next had been
+   made; starting from one seed, the i-th jump gives the i-th of 2^128
+   non-overlapping substreams, each 2^128 words long */
+static inline void xoshiro256_jump(xoshiro256 *g)
+{static const uint64_t JUMP[] = {0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+                                 0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL};
+ uint64_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+ int i, b;
+ for(i=0; i<4; i++)
+    for(b=0; b<64; b++)
+       {if(JUMP[i] & (1ULL << b))
+          {s0 ^= g->s[0]; s1 ^= g->s[1]; s2 ^= g->s[2]; s3 ^= g->s[3];}
+        xoshiro256_next(g);
+       }
+ g->s[0] = s0; g->s[1] = s1; g->s[2] = s2; g->s[3] = s3;
+}
+
+#endif /* XOSHIRO_H */
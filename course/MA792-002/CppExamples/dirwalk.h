@@ -0,0 +1,328 @@
+// File: C++Examples/dirwalk.h
+// Reads a directory tree into memory on several threads, without
+// opendir/readdir: each directory is opened with openat() relative to
+// the root and read with the getdents64 system call into a large
+// buffer, and the entry type comes from d_type (from fstatat() on file
+// systems that do not fill it in). A thread that finds subdirectories
+// queues them for whichever thread is free next. Symbolic links are
+// listed but not followed, as find does.
+// The names of a directory are kept in one string, each ended by '\0',
+// and its entries are sorted by name (byte order, as "LC_ALL=C ls"), so
+// the tree comes out the same however the threads ran.
+// The tree can then follow changes on disk: insert() and remove() keep
+// a directory's entries sorted, and read() reads a directory that
+// insert() added, with everything under it; prune() drops the nodes of
+// removed directories. Entries the caller does not want (a program's
+// own output, say) can be left out by a skip function.
+// Linux only; needs C++17 and -pthread.
+
+#ifndef DIRWALK_H
+#define DIRWALK_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <cerrno>
+#include <dirent.h> // for DT_DIR and DT_UNKNOWN
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+// one directory: its path relative to the root ("" for the root) and
+// its entries, sorted
+struct dir_node
+{std::string path;
+ std::string names;                // the names, each ended by '\0'
+ std::vector<std::uint32_t> name;  // the offset in names of entry k
+ std::vector<std::int32_t> child;  // the dir_node of entry k if it is a directory, else -1
+ int error = 0;                    // errno if the directory could not be read
+ bool live = true;                 // false once removed from the tree
+ int watch = -1;                   // for the caller, e.g. an inotify watch
+ std::size_t garbage = 0;          // bytes of names removed but still in names
+
+ std::size_t size() const {return name.size();}
+ std::string_view entry(std::size_t k) const
+   {return std::string_view(names.data() + name[k]);}
+};
+
+namespace dirwalk_detail
+{
+// the layout of the records getdents64 returns
+struct linux_dirent64
+{std::uint64_t d_ino;
+ std::int64_t d_off;
+ unsigned short d_reclen;
+ unsigned char d_type;
+ char d_name[];
+};
+
+const std::size_t BUFSIZE = 1 << 20;
+
+// read the entries of the open directory fd into n (unsorted), with
+// is_dir[k] for each; return 0 or an errno
+inline int read_dir(int fd, dir_node& n, std::vector<char>& is_dir, char* buf)
+{for(;;)
+   {long got = syscall(SYS_getdents64, fd, buf, BUFSIZE);
+    if(got < 0) return errno;
+    if(got == 0) return 0;
+    for(long off = 0; off < got; )
+       {const linux_dirent64* d = (const linux_dirent64*)(buf + off);
+        off += d->d_reclen;
+        const char* s = d->d_name;
+        if(s[0] == '.' && (s[1] == 0 || (s[1] == '.' && s[2] == 0))) continue;
+        bool dir = d->d_type == DT_DIR;
+        if(d->d_type == DT_UNKNOWN)
+          {struct stat st;
+           dir = fstatat(fd, s, &st, AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR(st.st_mode);
+          }
+        n.name.push_back((std::uint32_t)n.names.size());
+        n.names.append(s, std::strlen(s) + 1);
+        is_dir.push_back(dir);
+       }
+   }
+}
+} // namespace dirwalk_detail
+
+class dir_tree
+{public:
+ std::deque<dir_node> dirs; // dirs[0] is the root; a directory comes after its parent
+ // if set, called for each directory just before it is read, by the
+ // thread reading it
+ std::function<void(dir_node&)> before_read;
+ // if set, the entries name of a directory for which it is true are left
+ // out as the directory is read, by the thread reading it
+ std::function<bool(const dir_node&, std::string_view name)> skip;
+
+ dir_tree() = default;
+ dir_tree(const dir_tree&) = delete;
+ dir_tree& operator=(const dir_tree&) = delete;
+ ~dir_tree() {if(rootfd >= 0) close(rootfd);}
+
+ // read the tree under root with nthreads threads (0: one per core);
+ // return 0, or -1 with errno set if root cannot be opened. Directories
+ // that cannot be read have their error set and no entries.
+ int walk(const char* root, int nthreads = 0)
+   {dirs.clear();
+    dead = 0;
+    if(rootfd >= 0) close(rootfd);
+    rootfd = open(root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(rootfd < 0) return -1;
+    top = root;
+    dirs.emplace_back();
+    read(0, nthreads);
+    return 0;
+   }
+
+ // the root as given to walk(), and the path of dirs[k] from there
+ const std::string& root() const {return top;}
+ std::string full_path(std::size_t k) const
+   {return dirs[k].path.empty() ? top : top + '/' + dirs[k].path;}
+
+ // read dirs[k], a directory with no entries yet, and everything under it
+ void read(std::size_t k, int nthreads = 0)
+   {queue.assign(1, &dirs[k]);
+    busy = 0;
+    if(nthreads <= 0) nthreads = (int)std::thread::hardware_concurrency();
+    if(nthreads <= 0) nthreads = 1;
+    std::vector<std::thread> th;
+    for(int i = 1; i < nthreads; i++) th.emplace_back([this] {work();});
+    work();
+    for(auto& t: th) t.join();
+   }
+
+ // the index of the entry name of dirs[k], or -1
+ std::ptrdiff_t find(std::size_t k, std::string_view name) const
+   {const dir_node& n = dirs[k];
+    std::size_t i = lower(n, name);
+    return i < n.size() && n.entry(i) == name ? (std::ptrdiff_t)i : -1;
+   }
+
+ // add the entry name to dirs[k] in its place; for a directory, return
+ // its new dir_node (for read()), else -1; nothing changes and -1 is
+ // returned if the entry is there already
+ std::int32_t insert(std::size_t k, std::string_view name, bool dir)
+   {dir_node& n = dirs[k];
+    std::size_t i = lower(n, name);
+    if(i < n.size() && n.entry(i) == name) return -1;
+    n.name.insert(n.name.begin() + i, (std::uint32_t)n.names.size());
+    n.names.append(name.data(), name.size());
+    n.names += '\0';
+    n.child.insert(n.child.begin() + i, -1);
+    if(!dir) return -1;
+    std::int32_t c = (std::int32_t)dirs.size();
+    n.child[i] = c;
+    dirs.emplace_back();
+    dirs.back().path = n.path.empty() ? std::string(name) : n.path + '/' + std::string(name);
+    return c;
+   }
+
+ // remove the entry name from dirs[k]; return false if there is none.
+ // The directories under it are marked not live, and added to gone (if
+ // not null), each before those under it.
+ bool remove(std::size_t k, std::string_view name, std::vector<std::size_t>* gone = nullptr)
+   {std::ptrdiff_t i = find(k, name);
+    if(i < 0) return false;
+    dir_node& n = dirs[k];
+    if(n.child[i] >= 0)
+      {std::vector<std::size_t> stack(1, (std::size_t)n.child[i]);
+       while(!stack.empty())
+         {dir_node& d = dirs[stack.back()];
+          if(gone) gone->push_back(stack.back());
+          stack.pop_back();
+          d.live = false;
+          dead++;
+          for(std::int32_t c: d.child) if(c >= 0) stack.push_back((std::size_t)c);
+          d.names.clear(); d.names.shrink_to_fit();
+          d.name.clear(); d.name.shrink_to_fit();
+          d.child.clear(); d.child.shrink_to_fit();
+         }
+      }
+    n.garbage += name.size() + 1;
+    n.name.erase(n.name.begin() + i);
+    n.child.erase(n.child.begin() + i);
+    if(n.garbage > n.names.size() / 2) compact(n);
+    return true;
+   }
+
+ // the dir_nodes remove() has taken out of the tree but not yet dropped
+ std::size_t dead_dirs() const {return dead;}
+
+ // drop the dir_nodes of removed directories from dirs, moving the
+ // others down in the same order and renumbering the child links; a
+ // caller that keeps indexes of dirs must renumber its own, e.g. from
+ // dir_node::watch
+ void prune()
+   {std::vector<std::int32_t> to(dirs.size(), -1);
+    std::size_t m = 0;
+    for(std::size_t k = 0; k < dirs.size(); k++)
+       if(dirs[k].live)
+         {to[k] = (std::int32_t)m;
+          if(m != k) dirs[m] = std::move(dirs[k]);
+          m++;
+         }
+    dirs.resize(m);
+    for(dir_node& n: dirs)
+       for(std::int32_t& c: n.child) if(c >= 0) c = to[c];
+    dead = 0;
+   }
+
+ // f(path) for every entry, in order: a directory's sorted entries, each
+ // directory followed at once by what is under it, as find does when
+ // readdir returns sorted names; path is relative to the root
+ template<class F> void each(F f) const
+   {struct level {const dir_node* n; std::size_t k;};
+    std::vector<level> stack;
+    std::string path;
+    if(!dirs.empty()) stack.push_back({&dirs[0], 0});
+    while(!stack.empty())
+      {level& l = stack.back();
+       if(l.k == l.n->size())
+         {stack.pop_back();
+          continue;
+         }
+       std::size_t k = l.k++;
+       path.resize(l.n->path.size());
+       if(!path.empty()) path += '/';
+       path += l.n->entry(k);
+       f(std::string_view(path));
+       if(l.n->child[k] >= 0) stack.push_back({&dirs[l.n->child[k]], 0});
+      }
+   }
+
+ private:
+ int rootfd = -1;
+ std::string top;
+ std::size_t dead = 0;         // dir_nodes not live
+ std::mutex lock;
+ std::condition_variable more;
+ std::vector<dir_node*> queue; // directories still to read
+ int busy = 0;                 // threads reading one
+
+ static std::size_t lower(const dir_node& n, std::string_view name)
+   {std::size_t lo = 0, hi = n.size();
+    while(lo < hi)
+      {std::size_t mid = (lo + hi) / 2;
+       if(n.entry(mid) < name) lo = mid + 1; else hi = mid;
+      }
+    return lo;
+   }
+
+ // drop the removed names from names
+ static void compact(dir_node& n)
+   {std::string s;
+    s.reserve(n.names.size() - n.garbage);
+    for(std::uint32_t& o: n.name)
+       {std::string_view e(n.names.data() + o);
+        o = (std::uint32_t)s.size();
+        s.append(e.data(), e.size());
+        s += '\0';
+       }
+    n.names.swap(s);
+    n.garbage = 0;
+   }
+
+ void work()
+   {std::vector<char> buf(dirwalk_detail::BUFSIZE), is_dir;
+    std::vector<std::uint32_t> order;
+    std::unique_lock<std::mutex> l(lock);
+    for(;;)
+      {more.wait(l, [this] {return !queue.empty() || busy == 0;});
+       if(queue.empty()) break; // and no thread busy: all read
+       dir_node* n = queue.back();
+       queue.pop_back();
+       busy++;
+       l.unlock();
+
+       // read and sort, without the lock
+       if(before_read) before_read(*n);
+       dir_node tmp;
+       is_dir.clear();
+       int fd = n->path.empty() ? dup(rootfd)
+                : openat(rootfd, n->path.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+       if(fd < 0) n->error = errno;
+       else
+         {n->error = dirwalk_detail::read_dir(fd, tmp, is_dir, buf.data());
+          close(fd);
+         }
+       order.clear();
+       n->garbage = 0;
+       for(std::uint32_t k = 0; k < tmp.size(); k++)
+          if(!skip || !skip(*n, tmp.entry(k))) order.push_back(k);
+          else n->garbage += tmp.entry(k).size() + 1;
+       const char* s = tmp.names.data();
+       std::sort(order.begin(), order.end(), [&](std::uint32_t a, std::uint32_t b)
+                 {return std::strcmp(s + tmp.name[a], s + tmp.name[b]) < 0;});
+       n->names = std::move(tmp.names);
+       n->name.resize(order.size());
+       n->child.assign(order.size(), -1);
+       for(std::size_t k = 0; k < order.size(); k++) n->name[k] = tmp.name[order[k]];
+
+       // the subdirectories, in order, as new nodes to read
+       l.lock();
+       for(std::size_t k = 0; k < order.size(); k++)
+          if(is_dir[order[k]])
+            {n->child[k] = (std::int32_t)dirs.size();
+             dirs.emplace_back();
+             dir_node& c = dirs.back();
+             c.path = n->path;
+             if(!c.path.empty()) c.path += '/';
+             c.path += n->entry(k);
+             queue.push_back(&c);
+            }
+       busy--;
+       more.notify_all();
+      }
+   }
+};
+
+#endif // DIRWALK_H
@@ -0,0 +1,324 @@
+// File: C++Examples/format.h
+// printf formatting with the format parsed at compile time. scanf.c
+// builds its format with strcpy and strcat for every record, and printf
+// parses it again each time; here the format is a literal wrapped by
+// FMT(), parsed once by the compiler into a list of literal pieces and
+// conversions, and print() writes the fields with std::to_chars into the
+// buffer of an outbuf:
+//
+//    outbuf out(stdout);
+//    out.print(FMT("Read string:\"%s\", integer:%d, float:%5.2f;\n"), s, i, x);
+//
+// The output is the same as printf's, byte for byte. The conversions are
+// d i u o x X c s f F e E g G and %%, with the flags - + 0 and blank, a
+// width and a precision (no '*'). The length modifiers hh h l ll q j z t
+// convert an integer argument to their type as printf would (%hhx of 300
+// is 2c); without one the argument's own type is used. l is allowed, and
+// does nothing, on f e g; L, %lc and %ls are not supported. A bad format,
+// or an argument of the wrong kind or number, does not compile.
+// %s takes const char*, std::string or std::string_view.
+// Needs C++17 (g++ -std=c++17).
+
+#ifndef FORMAT_H
+#define FORMAT_H
+
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// the format as a type: a class with a constexpr get() returning it
+#define FMT(s) [] {struct fmt_ {static constexpr const char* get() {return s;}}; \
+                   return fmt_();}()
+
+namespace format_detail
+{
+// a literal piece followed by a conversion; conv is 0 after the last piece
+struct item
+{std::size_t lit, litlen; // the literal piece, in the format string
+ char conv;
+ bool left, plus, blank, zero;
+ int width, prec;         // prec -1 if none
+ char len;                // length modifier: 0, H (hh), h, l, q (ll), j, z or t
+ int arg;                 // the argument, -1 for %% and the end
+};
+
+constexpr bool is_digit(char c) {return c >= '0' && c <= '9';}
+
+constexpr std::size_t count_items(const char* f)
+  {std::size_t n = 1;
+   for(std::size_t k = 0; f[k] != 0; k++)
+      if(f[k] == '%')
+        {n++;
+         if(f[k+1] == '%') k++;
+        }
+   return n;
+  }
+
+// a throw in a constexpr evaluation stops the compilation
+template<std::size_t N> constexpr std::array<item, N> parse(const char* f)
+  {std::array<item, N> it{};
+   std::size_t k = 0, lit = 0;
+   int arg = 0;
+   for(std::size_t n = 0; n < N; n++)
+      {item& m = it[n];
+       while(f[k] != 0 && f[k] != '%') k++;
+       m.lit = lit; m.litlen = k - lit;
+       m.prec = -1; m.arg = -1;
+       if(f[k] == 0) break; // m.conv == 0
+       k++;
+       for(;; k++)
+          if(f[k] == '-') m.left = true;
+          else if(f[k] == '+') m.plus = true;
+          else if(f[k] == ' ') m.blank = true;
+          else if(f[k] == '0') m.zero = true;
+          else break;
+       while(is_digit(f[k])) m.width = 10 * m.width + (f[k++] - '0');
+       if(f[k] == '.')
+         {m.prec = 0;
+          for(k++; is_digit(f[k]); k++) m.prec = 10 * m.prec + (f[k] - '0');
+         }
+       if(f[k] == 'h' || f[k] == 'l')
+         {m.len = f[k++];
+          if(f[k] == m.len) {m.len = m.len == 'h' ? 'H' : 'q'; k++;}
+         }
+       else if(f[k] == 'q' || f[k] == 'j' || f[k] == 'z' || f[k] == 't') m.len = f[k++];
+       else if(f[k] == 'L') throw "format.h: long double (L) is not supported";
+       switch(f[k]){
+       case '%': break;
+       case 'd': case 'i': case 'u': case 'o': case 'x': case 'X':
+         m.arg = arg++;
+         break;
+       case 'c': case 's':
+         if(m.len != 0) throw "format.h: wide characters (%lc, %ls) are not supported";
+         m.arg = arg++;
+         break;
+       case 'f': case 'F': case 'e': case 'E': case 'g': case 'G':
+         if(m.len != 0 && m.len != 'l')
+           throw "format.h: length modifier on a floating conversion";
+         m.arg = arg++;
+         break;
+       default: throw "format.h: unsupported conversion";
+       }
+       m.conv = f[k++];
+       lit = k;
+      }
+   return it;
+  }
+
+template<class S> inline constexpr std::size_t nitems = count_items(S::get());
+template<class S> inline constexpr auto items = parse<nitems<S>>(S::get());
+
+template<class S> constexpr int nargs()
+  {int n = 0;
+   for(const item& m: items<S>) if(m.arg >= 0) n++;
+   return n;
+  }
+
+template<class T> using bare = std::remove_cv_t<std::remove_reference_t<T>>;
+
+template<class T> constexpr bool is_string()
+  {using U = bare<T>;
+   return std::is_same_v<U, std::string> || std::is_same_v<U, std::string_view>
+          || std::is_convertible_v<U, const char*>;
+  }
+
+// an integer as the type of length modifier L, signed for %d and %i
+template<char L, bool Signed, class T> constexpr auto with_length(T v)
+  {using S = std::conditional_t<L == 'H', signed char,
+             std::conditional_t<L == 'h', short,
+             std::conditional_t<L == 'l', long,
+             std::conditional_t<L == 'q', long long,
+             std::conditional_t<L == 'j', std::intmax_t,
+             std::conditional_t<L == 'z', std::size_t, std::ptrdiff_t>>>>>>;
+   using R = std::conditional_t<Signed, std::make_signed_t<S>, std::make_unsigned_t<S>>;
+   return (R)v;
+  }
+
+template<class T> constexpr bool fits(char conv)
+  {switch(conv){
+   case 'd': case 'i': case 'u': case 'o': case 'x': case 'X': case 'c':
+     return std::is_integral_v<bare<T>>;
+   case 's':
+     return is_string<T>();
+   default:
+     return std::is_floating_point_v<bare<T>>;
+   }
+  }
+}
+
+// a buffer in front of a FILE*; it is written out when full, by flush(),
+// and when the outbuf goes away
+class outbuf
+{std::FILE* f;
+ std::vector<char> buf;
+ std::size_t len;
+
+ // room for n more characters
+ char* room(std::size_t n)
+   {if(len + n > buf.size())
+      {flush();
+       if(n > buf.size()) buf.resize(n);
+      }
+    return buf.data() + len;
+   }
+
+ // a field: prefix (sign, 0x), nz zeros (of a precision) and body,
+ // padded to the width
+ void field(const format_detail::item& m, const char* pre, std::size_t prelen,
+            const char* body, std::size_t bodylen, bool zero, std::size_t nz = 0)
+   {std::size_t n = prelen + nz + bodylen;
+    std::size_t pad = (std::size_t)m.width > n ? (std::size_t)m.width - n : 0;
+    char* p = room(n + pad);
+    if(!m.left && !zero) {std::memset(p, ' ', pad); p += pad;}
+    if(prelen) {std::memcpy(p, pre, prelen); p += prelen;}
+    if(!m.left && zero) {std::memset(p, '0', pad); p += pad;}
+    std::memset(p, '0', nz); p += nz;
+    std::memcpy(p, body, bodylen); p += bodylen;
+    if(m.left) {std::memset(p, ' ', pad); p += pad;}
+    len = (std::size_t)(p - buf.data());
+   }
+
+ template<class T> void integer(const format_detail::item& m, T v)
+   {using U = std::make_unsigned_t<std::conditional_t<std::is_same_v<T, bool>, unsigned, T>>;
+    char pre[2];
+    std::size_t prelen = 0;
+    U u = (U)v;
+    if(m.conv == 'c')
+      {char c = (char)(unsigned char)v;
+       field(m, nullptr, 0, &c, 1, false);
+       return;
+      }
+    if(m.conv == 'd' || m.conv == 'i')
+      {if constexpr(std::is_signed_v<T>)
+         if(v < 0) {pre[prelen++] = '-'; u = (U)0 - u;}
+       if(prelen == 0 && (m.plus || m.blank)) pre[prelen++] = m.plus ? '+' : ' ';
+      }
+    int base = m.conv == 'o' ? 8 : m.conv == 'x' || m.conv == 'X' ? 16 : 10;
+    char digits[64];
+    std::size_t nd = 0;
+    if(u != 0 || m.prec != 0)
+      nd = (std::size_t)(std::to_chars(digits, digits + sizeof(digits), u, base).ptr - digits);
+    if(m.conv == 'X')
+      for(std::size_t k = 0; k < nd; k++)
+         if(digits[k] >= 'a') digits[k] = (char)(digits[k] - 'a' + 'A');
+    // the precision is the least number of digits
+    std::size_t nz = m.prec > 0 && (std::size_t)m.prec > nd ? (std::size_t)m.prec - nd : 0;
+    field(m, pre, prelen, digits, nd, m.zero && m.prec < 0, nz);
+   }
+
+ void floating(const format_detail::item& m, double v)
+   {std::chars_format cf = m.conv == 'f' || m.conv == 'F' ? std::chars_format::fixed
+                         : m.conv == 'e' || m.conv == 'E' ? std::chars_format::scientific
+                         : std::chars_format::general;
+    int prec = m.prec < 0 ? 6 : m.prec;
+    if(cf == std::chars_format::general && prec == 0) prec = 1;
+    char pre[1], small[128];
+    std::size_t prelen = 0;
+    bool neg = std::signbit(v);
+    if(neg) v = -v;
+    else if(m.plus || m.blank) pre[prelen++] = m.plus ? '+' : ' ';
+    if(neg) pre[prelen++] = '-';
+
+    // the digits before the point (%f of 1e308 has 309), the point, the
+    // precision, and "e+308" with room to spare
+    std::size_t need = (std::size_t)prec + 16;
+    if(cf == std::chars_format::fixed && std::isfinite(v) && v >= 1)
+      need += (std::size_t)std::log10(v) + 2;
+    std::vector<char> big;
+    char* body = small;
+    std::size_t cap = sizeof(small);
+    if(need > cap)
+      {big.resize(need);
+       body = big.data(); cap = big.size();
+      }
+    std::to_chars_result r = std::to_chars(body, body + cap, v, cf, prec);
+    while(r.ec == std::errc::value_too_large) // not expected; grow anyway
+      {big.resize(2 * cap);
+       body = big.data(); cap = big.size();
+       r = std::to_chars(body, body + cap, v, cf, prec);
+      }
+    std::size_t n = (std::size_t)(r.ptr - body);
+    if(m.conv == 'F' || m.conv == 'E' || m.conv == 'G')
+      for(std::size_t k = 0; k < n; k++)
+         if(body[k] >= 'a' && body[k] <= 'z') body[k] = (char)(body[k] - 'a' + 'A');
+    field(m, pre, prelen, body, n, m.zero && std::isfinite(v));
+   }
+
+ void string(const format_detail::item& m, std::string_view s)
+   {if(m.prec >= 0 && (std::size_t)m.prec < s.size()) s = s.substr(0, (std::size_t)m.prec);
+    field(m, nullptr, 0, s.data(), s.size(), false);
+   }
+
+ template<class T> void arg(const format_detail::item& m, const T& v)
+   {if constexpr(format_detail::is_string<T>())
+      {if constexpr(std::is_convertible_v<T, const char*>)
+         {const char* s = v;
+          if(m.prec < 0) string(m, std::string_view(s));
+          else string(m, std::string_view(s, strnlen(s, (std::size_t)m.prec)));
+         }
+       else string(m, std::string_view(v));
+      }
+    else if constexpr(std::is_floating_point_v<T>) floating(m, (double)v);
+    else integer(m, v);
+   }
+
+ template<class S, std::size_t I, class Tup> void piece(const Tup& args)
+   {constexpr format_detail::item m = format_detail::items<S>[I];
+    if constexpr(m.litlen > 0)
+      {char* p = room(m.litlen);
+       std::memcpy(p, S::get() + m.lit, m.litlen);
+       len += m.litlen;
+      }
+    if constexpr(m.conv == '%')
+      {*room(1) = '%';
+       len++;
+      }
+    else if constexpr(m.arg >= 0)
+      {using T = format_detail::bare<std::tuple_element_t<(std::size_t)m.arg, Tup>>;
+       static_assert(format_detail::fits<T>(m.conv), "format.h: argument does not fit its conversion");
+       if constexpr(m.len != 0 && std::is_integral_v<T>)
+         arg(m, format_detail::with_length<m.len, m.conv == 'd' || m.conv == 'i'>(std::get<m.arg>(args)));
+       else arg(m, std::get<m.arg>(args));
+      }
+   }
+
+ template<class S, class Tup, std::size_t... I>
+ void pieces(const Tup& args, std::index_sequence<I...>)
+   {(piece<S, I>(args), ...);
+   }
+
+ public:
+ explicit outbuf(std::FILE* file, std::size_t size = 1 << 16)
+   : f(file), buf(size), len(0) {}
+ outbuf(const outbuf&) = delete;
+ outbuf& operator=(const outbuf&) = delete;
+ ~outbuf() {flush();}
+
+ // returns 0, or EOF on a write error
+ int flush()
+   {std::size_t n = len;
+    len = 0;
+    if(n > 0 && std::fwrite(buf.data(), 1, n, f) != n) return EOF;
+    return std::fflush(f);
+   }
+
+ template<class S, class... A> void print(S, const A&... args)
+   {static_assert(format_detail::nargs<S>() == (int)sizeof...(A),
+                  "format.h: number of arguments differs from the format");
+    pieces<S>(std::tuple<const A&...>(args...),
+              std::make_index_sequence<format_detail::nitems<S>>());
+   }
+};
+
+#endif // FORMAT_H
@@ -0,0 +1,169 @@
+// File: C++Examples/htmlout.h
+// Buffered HTML output for makefilelist.cpp. Text is collected in a
+// large buffer and written with write(2) only when the buffer is full
+// and at the end, not at every line as endl does.
+// text() escapes the five characters that are special in HTML
+// (& < > " '), and url() percent-encodes every byte of a path but
+// letters, digits, - . _ ~ and /, so that a name with blanks, quotes,
+// '#', '?' or non-ASCII bytes still links to itself. Most names need no
+// escaping, so both scan 16 bytes at a time with SSE2 (on x86-64) for
+// the first byte that does, and copy everything before it in one go.
+// Given a string instead of a file descriptor, it appends to the string,
+// so a page can be built in memory (to be compressed, say).
+// Needs C++17.
+
+#ifndef HTMLOUT_H
+#define HTMLOUT_H
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cerrno>
+#include <unistd.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace htmlout_detail
+{
+inline bool html_special(unsigned char c)
+{return c == '&' || c == '<' || c == '>' || c == '"' || c == '\'';}
+
+inline bool url_safe(unsigned char c)
+{return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '-' && c <= '9')
+        || c == '_' || c == '~';
+}
+
+#if defined(__SSE2__)
+// the bytes of v equal to c
+inline __m128i eq(__m128i v, char c) {return _mm_cmpeq_epi8(v, _mm_set1_epi8(c));}
+
+// the bytes of v in [lo, hi], for lo and hi below 0x80 (bytes from 0x80
+// up are negative as signed bytes, and never in range)
+inline __m128i in(__m128i v, char lo, char hi)
+{return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8((char)(lo - 1))),
+                      _mm_cmplt_epi8(v, _mm_set1_epi8((char)(hi + 1))));
+}
+#endif
+
+// the index of the first byte of s[0..n) that text() escapes, or n
+inline std::size_t find_html(const char* s, std::size_t n)
+{std::size_t i = 0;
+#if defined(__SSE2__)
+ for(; i + 16 <= n; i += 16)
+    {__m128i v = _mm_loadu_si128((const __m128i*)(s + i));
+     __m128i m = _mm_or_si128(_mm_or_si128(eq(v, '&'), eq(v, '<')),
+                              _mm_or_si128(_mm_or_si128(eq(v, '>'), eq(v, '"')), eq(v, '\'')));
+     if(int bits = _mm_movemask_epi8(m)) return i + __builtin_ctz(bits);
+    }
+#endif
+ for(; i < n; i++) if(html_special((unsigned char)s[i])) return i;
+ return n;
+}
+
+// the index of the first byte of s[0..n) that url() encodes, or n
+inline std::size_t find_url(const char* s, std::size_t n)
+{std::size_t i = 0;
+#if defined(__SSE2__)
+ for(; i + 16 <= n; i += 16)
+    {__m128i v = _mm_loadu_si128((const __m128i*)(s + i));
+     __m128i ok = _mm_or_si128(_mm_or_si128(in(v, 'a', 'z'), in(v, 'A', 'Z')),
+                               _mm_or_si128(_mm_or_si128(in(v, '-', '9'), eq(v, '_')), eq(v, '~')));
+     if(int bits = _mm_movemask_epi8(ok) ^ 0xffff) return i + __builtin_ctz(bits);
+    }
+#endif
+ for(; i < n; i++) if(!url_safe((unsigned char)s[i])) return i;
+ return n;
+}
+} // namespace htmlout_detail
+
+class html_out
+{int fd;
+ std::string* sink; // if not null, where the output goes instead of fd
+ std::vector<char> buf;
+ std::size_t len;
+ bool bad;
+
+ void put(const char* s, std::size_t n)
+   {if(len + n > buf.size())
+      {flush();
+       if(n > buf.size()) {write_all(s, n); return;}
+      }
+    std::memcpy(buf.data() + len, s, n);
+    len += n;
+   }
+
+ void write_all(const char* s, std::size_t n)
+   {if(sink)
+      {sink->append(s, n);
+       return;
+      }
+    while(n > 0 && !bad)
+      {ssize_t w = ::write(fd, s, n);
+       if(w < 0 && errno == EINTR) continue;
+       if(w <= 0) {bad = true; break;}
+       s += w;
+       n -= (std::size_t)w;
+      }
+   }
+
+ public:
+ explicit html_out(int file, std::size_t size = 1 << 20)
+   : fd(file), sink(nullptr), buf(size), len(0), bad(false) {}
+ explicit html_out(std::string& s, std::size_t size = 1 << 16)
+   : fd(-1), sink(&s), buf(size), len(0), bad(false) {}
+ html_out(const html_out&) = delete;
+ html_out& operator=(const html_out&) = delete;
+ ~html_out() {flush();}
+
+ // s as it is
+ void raw(std::string_view s) {put(s.data(), s.size());}
+
+ // s with & < > " ' as character references
+ void text(std::string_view s)
+   {const char* p = s.data();
+    std::size_t n = s.size();
+    for(;;)
+      {std::size_t k = htmlout_detail::find_html(p, n);
+       put(p, k);
+       if(k == n) break;
+       switch(p[k]){
+       case '&': raw("&amp;"); break;
+       case '<': raw("&lt;"); break;
+       case '>': raw("&gt;"); break;
+       case '"': raw("&quot;"); break;
+       default: raw("&#39;"); break;
+       }
+       p += k + 1;
+       n -= k + 1;
+      }
+   }
+
+ // s percent-encoded for an href, '/' kept
+ void url(std::string_view s)
+   {static const char hex[] = "0123456789ABCDEF";
+    const char* p = s.data();
+    std::size_t n = s.size();
+    for(;;)
+      {std::size_t k = htmlout_detail::find_url(p, n);
+       put(p, k);
+       if(k == n) break;
+       unsigned char c = (unsigned char)p[k];
+       char e[3] = {'%', hex[c >> 4], hex[c & 15]};
+       put(e, 3);
+       p += k + 1;
+       n -= k + 1;
+      }
+   }
+
+ // write what is buffered; returns 0, or -1 if a write has failed
+ int flush()
+   {write_all(buf.data(), len);
+    len = 0;
+    return bad ? -1 : 0;
+   }
+};
+
+#endif // HTMLOUT_H
@@ -5,10 +5,12 @@
 // STL items demonstrated
 // generic algorithm sort with a comparator "function"
 // /usr/lib/gcc/i686-pc-cygwin/3.4.4/include/c++/bits
+// the arrays are printed a field at a time through format.h
+// compile as "g++ -std=c++17 indir_sort.cpp"
 
 #include <iostream>
-#include <iomanip>
 #include <algorithm>
+#include "format.h"
 
 using namespace std;
 
@@ -68,18 +70,19 @@ int main(int argc, char** argv)
   sscanf(argv[3], "%d",&seed);
   srand(seed);
   for(i = 0; i < size; i++) array[i] = rand() % mod;
-  cout << endl;
+  outbuf out(stdout);
+  out.print(FMT("\n"));
 
-  cout << "Input array" << endl;
-  for(i=0;i<size;i++) cout << setw(3) << array[i] << " ";
-  cout<<endl;
+  out.print(FMT("Input array\n"));
+  for(i=0;i<size;i++) out.print(FMT("%3d "), array[i]);
+  out.print(FMT("\n"));
   // print positions also
-  for(i=0;i<size;i++) cout << setw(3) << i << " "; cout<<endl;
+  for(i=0;i<size;i++) out.print(FMT("%3d "), i); out.print(FMT("\n"));
 
   comp = indir_sort<int>(array, size, indexarray);
 
-  cout << "STL-sorted array after " << comp << " comparisons" << endl;
-  for(i = 0; i < size; i++) cout << setw(3) << array[indexarray[i]] << " ";
-  cout << endl;
-  for(i=0;i<size;i++) cout << setw(3) << indexarray[i] << " "; cout<<endl;
+  out.print(FMT("STL-sorted array after %d comparisons\n"), comp);
+  for(i = 0; i < size; i++) out.print(FMT("%3d "), array[indexarray[i]]);
+  out.print(FMT("\n"));
+  for(i=0;i<size;i++) out.print(FMT("%3d "), indexarray[i]); out.print(FMT("\n"));
 }
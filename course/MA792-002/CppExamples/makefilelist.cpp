@@ -1,18 +1,627 @@
+// File: C++Examples/makefilelist.cpp
+// Writes an HTML page of links to files: to the names read from stdin,
+// one per line ("ls | makefilelist"), or, given a directory, to
+// everything under it, which it reads itself on several threads (see
+// dirwalk.h), in the order of a sorted "find". Names are escaped for
+// HTML and URLs and the page is written in large blocks (see htmlout.h).
+// With -o, it writes instead one page per directory of the tree,
+// outdir/<directory>/index.html, linking to the directory's entries by
+// their names, to be served at the directory's own URL. With -d as
+// well, it then stays running as a daemon: it keeps the tree in memory,
+// watches every directory with inotify, and when something is created,
+// deleted or moved, rewrites only the pages of the directories that
+// changed. Changes are collected until there are none for -w
+// milliseconds (100 by default, but never more than 10 times that after
+// the first), so that a burst of them costs one rewrite of each page.
+// A page is written to a temporary file and renamed over the old one,
+// so a reader sees either the old page or the new one. Pages begin with
+// a mark, and only files with the mark are ever replaced or removed: a
+// directory where an index.html (or index-N.html, or a .gz of one) of
+// someone else's is in the way is reported, and its pages not written.
+// With -n, a directory's page holds at most that many entries, and a
+// large directory gets several: index.html, index-2.html, ..., each with
+// links to the first, the last, and the nearby pages. With -z, each page
+// gets a gzip-compressed copy, index.html.gz, for a web server to send
+// as it is (nginx's gzip_static, say) instead of compressing on every
+// request. Pages are built and compressed in memory, a page at a time on
+// each of the -j threads.
+// outdir may be the directory listed, or inside it: the pages and their
+// .gz and temporary files (or the directory outdir) are then left out
+// of the listing, and the daemon pays no attention to its own writes;
+// other files named like pages are listed as usual.
+// run as "makefilelist [-j threads] [directory] > list.html"
+//     or "makefilelist [-j threads] -o outdir [-n entries] [-z] [-d [-w ms] [-v]] directory"
+// compile as "g++ -Wall -std=c++17 -O2 -pthread makefilelist.cpp -lz"
 #include <iostream>
 #include <string>
+#include <set>
+#include <unordered_map>
+#include <chrono>
+#include <atomic>
+#include <thread>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+#include <zlib.h>
+#include "dirwalk.h"
+#include "htmlout.h"
 
 using namespace std;
 
+// one link
+static void entry(html_out& out, string_view name)
+{out.raw("<a href=\"");
+ out.url(name);
+ out.raw("\">");
+ out.text(name);
+ out.raw("</a><br>\n");
+}
+
+// ---------- one page per directory ----------
+
+// how the pages are written
+struct page_opts
+{string outdir;
+ size_t per_page = 0; // entries per page, 0 for all on one
+ bool gzip = false;   // a .gz of each page as well
+ int nthreads = 0;
+};
+
+// the directory of the pages of a directory: outdir/<path>
+static string page_dir(const string& outdir, const string& path)
+{return path.empty() ? outdir : outdir + '/' + path;
+}
+
+// the file of page p (from 0): index.html, index-2.html, ...
+static string page_name(size_t p)
+{return p == 0 ? string("index.html") : "index-" + to_string(p + 1) + ".html";
+}
+
+// the first line of every page, by which the program knows its own
+static const char page_mark[] = "<html>\n<!-- makefilelist -->\n";
+
+// the temporary file of dir/name: dir/.name.makefilelist.tmp
+static string temp_name(const string& dir, const string& name)
+{return dir + "/." + name + ".makefilelist.tmp";
+}
+
+// true if the file path begins with page_mark, once uncompressed if it
+// is a .gz (gzread reads other files as they are)
+static bool our_page(const string& path)
+{gzFile f = gzopen(path.c_str(), "rb");
+ if(f == nullptr) return false;
+ char buf[sizeof page_mark - 1];
+ int n = gzread(f, buf, sizeof buf);
+ gzclose(f);
+ return n == (int)sizeof buf && memcmp(buf, page_mark, sizeof buf) == 0;
+}
+
+// true if path may be written over: there is no such file, or it is a
+// page of ours
+static bool replaceable(const string& path)
+{struct stat st;
+ if(lstat(path.c_str(), &st) < 0) return errno == ENOENT;
+ return S_ISREG(st.st_mode) && our_page(path);
+}
+
+// unlink path if it is a page of ours; return false if there is no path
+// (or it cannot be looked at)
+static bool remove_ours(const string& path)
+{struct stat st;
+ if(lstat(path.c_str(), &st) < 0) return false;
+ if(S_ISREG(st.st_mode) && our_page(path)) unlink(path.c_str());
+ return true;
+}
+
+static size_t page_count(const page_opts& o, const dir_node& n)
+{return o.per_page == 0 || n.size() == 0 ? 1 : (n.size() + o.per_page - 1) / o.per_page;
+}
+
+// mkdir -p
+static int make_dirs(const string& dir)
+{for(size_t i = 1; i <= dir.size(); i++)
+    if(i == dir.size() || dir[i] == '/')
+      if(mkdir(dir.substr(0, i).c_str(), 0777) < 0 && errno != EEXIST) return -1;
+ return 0;
+}
+
+// write data to dir/name through a temporary file renamed into place, so
+// a reader sees either the old file or the new one; return 0, or -1
+// with errno set
+static int write_file(const string& dir, const string& name, const string& data)
+{string tmp = temp_name(dir, name);
+ int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+ if(fd < 0) return -1;
+ const char* p = data.data();
+ size_t left = data.size();
+ while(left > 0)
+    {ssize_t w = write(fd, p, left);
+     if(w < 0 && errno == EINTR) continue;
+     if(w <= 0) break;
+     p += w;
+     left -= (size_t)w;
+    }
+ if(left > 0 || close(fd) < 0 || rename(tmp.c_str(), (dir + '/' + name).c_str()) < 0)
+   {int e = errno;
+    if(left > 0) close(fd);
+    unlink(tmp.c_str());
+    errno = e;
+    return -1;
+   }
+ return 0;
+}
+
+// in, gzip compressed at the highest level into out; return 0 or -1
+static int gzip(const string& in, string& out)
+{z_stream z;
+ memset(&z, 0, sizeof z);
+ // 15 + 16: a 32K window and a gzip header and trailer, not zlib's
+ if(deflateInit2(&z, 9, Z_DEFLATED, 15 + 16, 9, Z_DEFAULT_STRATEGY) != Z_OK) return -1;
+ out.resize(deflateBound(&z, in.size()));
+ z.next_in = (Bytef*)in.data();
+ z.avail_in = (uInt)in.size();
+ z.next_out = (Bytef*)&out[0];
+ z.avail_out = (uInt)out.size();
+ int r = deflate(&z, Z_FINISH);
+ out.resize(z.total_out);
+ deflateEnd(&z);
+ return r == Z_STREAM_END ? 0 : -1;
+}
+
+// the links to the other pages of a directory: the first, the last, and
+// those within 5 of page p
+static void page_links(html_out& out, size_t p, size_t pages)
+{out.raw("<p>Page ");
+ out.raw(to_string(p + 1));
+ out.raw(" of ");
+ out.raw(to_string(pages));
+ out.raw(":");
+ size_t lo = p > 5 ? p - 5 : 0, hi = min(pages, p + 6);
+ auto link = [&](size_t q, const string& label)
+   {out.raw(" <a href=\"");
+    out.raw(page_name(q));
+    out.raw("\">");
+    out.raw(label);
+    out.raw("</a>");
+   };
+ if(p > 0) link(p - 1, "&laquo; previous");
+ if(lo > 0) {link(0, "1"); if(lo > 1) out.raw(" ...");}
+ for(size_t q = lo; q < hi; q++)
+    if(q == p) {out.raw(" <b>"); out.raw(to_string(q + 1)); out.raw("</b>");}
+    else link(q, to_string(q + 1));
+ if(hi < pages) {if(hi < pages - 1) out.raw(" ..."); link(pages - 1, to_string(pages));}
+ if(p + 1 < pages) link(p + 1, "next &raquo;");
+ out.raw("</p>\n");
+}
+
+// write page p of n (and its .gz), building it in html; return 0, or -1
+// with errno set
+static int write_page(const page_opts& o, const dir_node& n, size_t p, string& html, string& gz)
+{size_t pages = page_count(o, n), per = o.per_page ? o.per_page : n.size();
+ size_t from = min(n.size(), p * per), to = min(n.size(), from + per);
+ html.clear();
+ {html_out out(html);
+  out.raw(page_mark);
+  out.raw("<h2>Directory listing of /");
+  out.text(n.path);
+  out.raw("</h2>\n");
+  if(pages > 1) page_links(out, p, pages);
+  if(!n.path.empty()) out.raw("<a href=\"../\">..</a><br>\n");
+  for(size_t k = from; k < to; k++)
+     {string_view e = n.entry(k);
+      out.raw("<a href=\"");
+      out.url(e);
+      if(n.child[k] >= 0) out.raw("/");
+      out.raw("\">");
+      out.text(e);
+      if(n.child[k] >= 0) out.raw("/");
+      out.raw("</a><br>\n");
+     }
+  if(pages > 1) page_links(out, p, pages);
+  out.raw("</html>\n");
+ }
+ string dir = page_dir(o.outdir, n.path), name = page_name(p);
+ if(o.gzip)
+   {if(gzip(html, gz) < 0) {errno = ENOMEM; return -1;}
+    // the .gz first: a server that prefers it never pairs a new page
+    // with an old .gz for long
+    if(write_file(dir, name + ".gz", gz) < 0) return -1;
+   }
+ else remove_ours(dir + '/' + name + ".gz");
+ return write_file(dir, name, html);
+}
+
+// remove the pages of a directory from page `from' on (with their .gz),
+// those of ours
+static void remove_pages(const string& dir, size_t from)
+{for(size_t p = from; ; p++)
+    {string f = dir + '/' + page_name(p);
+     remove_ours(f + ".gz");
+     if(!remove_ours(f)) break;
+    }
+}
+
+// remove the pages of a directory that has gone, and its directory in
+// outdir if that is now empty
+static void remove_page(const string& outdir, const string& path)
+{string dir = page_dir(outdir, path);
+ remove_pages(dir, 0);
+ rmdir(dir.c_str());
+}
+
+// write the pages of the live dirs[k] for each k in which, on
+// o.nthreads threads, a page to a thread at a time, and remove pages
+// past their new last. A directory with a file not of ours where one of
+// its pages goes is reported and left alone, and counted in *blocked.
+// Return the number of pages written, or -1 after reporting an error
+static long write_pages(const dir_tree& tree, const vector<size_t>& which, const page_opts& o,
+                        const char* prog, size_t* blocked = nullptr)
+{struct job {size_t k, p;};
+ vector<job> jobs;
+ vector<size_t> done;
+ for(size_t k: which)
+    {const dir_node& n = tree.dirs[k];
+     if(!n.live) continue;
+     string dir = page_dir(o.outdir, n.path);
+     if(make_dirs(dir) < 0)
+       {cerr << prog << ": " << dir << ": " << strerror(errno) << endl;
+        return -1;
+       }
+     size_t m = page_count(o, n), p;
+     for(p = 0; p < m; p++)
+        {string f = dir + '/' + page_name(p);
+         if(!replaceable(f) || (o.gzip && !replaceable(f + ".gz")))
+           {cerr << prog << ": " << (replaceable(f) ? f + ".gz" : f)
+                 << ": not written by makefilelist; not replacing it" << endl;
+            break;
+           }
+        }
+     if(p < m)
+       {if(blocked) ++*blocked;
+        continue;
+       }
+     for(p = 0; p < m; p++) jobs.push_back({k, p});
+     done.push_back(k);
+    }
+
+ atomic<size_t> next(0);
+ atomic<int> failed(0);
+ auto work = [&]
+   {string html, gz;
+    for(size_t j; (j = next++) < jobs.size(); )
+       if(write_page(o, tree.dirs[jobs[j].k], jobs[j].p, html, gz) < 0)
+         {int e = 0;
+          failed.compare_exchange_strong(e, errno ? errno : EIO);
+         }
+   };
+ int nthreads = o.nthreads > 0 ? o.nthreads : (int)thread::hardware_concurrency();
+ nthreads = max(1, min(nthreads, (int)jobs.size()));
+ vector<thread> th;
+ for(int i = 1; i < nthreads; i++) th.emplace_back(work);
+ work();
+ for(auto& t: th) t.join();
+ if(failed)
+   {cerr << prog << ": " << o.outdir << ": " << strerror(failed) << endl;
+    return -1;
+   }
+
+ for(size_t k: done)
+    remove_pages(page_dir(o.outdir, tree.dirs[k].path), page_count(o, tree.dirs[k]));
+ return (long)jobs.size();
+}
+
+static long write_pages(const dir_tree& tree, const page_opts& o, const char* prog,
+                        size_t* blocked = nullptr)
+{vector<size_t> all(tree.dirs.size());
+ for(size_t k = 0; k < all.size(); k++) all[k] = k;
+ return write_pages(tree, all, o, prog, blocked);
+}
+
+static void report_errors(const dir_tree& tree, size_t from, const char* prog)
+{for(size_t k = from; k < tree.dirs.size(); k++)
+    if(tree.dirs[k].error)
+      cerr << prog << ": " << tree.full_path(k) << ": " << strerror(tree.dirs[k].error) << endl;
+}
+
+// the temporary name of a page (see temp_name)
+static bool temp_file(string_view s)
+{string_view tmp = ".makefilelist.tmp";
+ return s.size() > tmp.size() + 1 && s[0] == '.' && s.substr(s.size() - tmp.size()) == tmp;
+}
+
+// index.html, index-N.html, and their .gz: the names of pages
+static bool page_file(string_view s)
+{if(s.size() > 3 && s.substr(s.size() - 3) == ".gz") s.remove_suffix(3);
+ if(s == "index.html") return true;
+ if(s.size() <= 11 || s.substr(0, 6) != "index-" || s.substr(s.size() - 5) != ".html")
+   return false;
+ for(char c: s.substr(6, s.size() - 11)) if(c < '0' || c > '9') return false;
+ return true;
+}
+
+// keep the pages out of the tree they list when outdir is in it: with
+// outdir the root itself, the temporary files and the pages of ours in
+// every directory, and with outdir below the root, the directory outdir.
+// Else the daemon would see each page it writes as a change, and write
+// it again, for ever. Return 0, or -1 with errno set if outdir cannot be
+// made.
+static int skip_pages(dir_tree& tree, const char* root, const string& outdir)
+{if(make_dirs(outdir) < 0) return -1;
+ char* r = realpath(root, nullptr);
+ char* o = realpath(outdir.c_str(), nullptr);
+ string rs = r ? r : "", os = o ? o : "";
+ free(r);
+ free(o);
+ if(rs.empty() || os.empty()) return 0; // walk() reports a bad root
+ string prefix = rs == "/" ? rs : rs + '/';
+ if(os == rs)
+   tree.skip = [root = string(root)](const dir_node& n, string_view name)
+     {if(temp_file(name)) return true;
+      if(!page_file(name)) return false;
+      string f = root;
+      if(!n.path.empty()) f += '/' + n.path;
+      return our_page(f.append("/").append(name));
+     };
+ else if(os.compare(0, prefix.size(), prefix) == 0)
+   tree.skip = [rel = os.substr(prefix.size())](const dir_node& n, string_view name)
+     {if(n.path.empty()) return name == rel;
+      return rel.size() == n.path.size() + 1 + name.size()
+             && rel.compare(0, n.path.size(), n.path) == 0 && rel[n.path.size()] == '/'
+             && string_view(rel).substr(n.path.size() + 1) == name;
+     };
+ return 0;
+}
+
+// ---------- the daemon ----------
+
+static const uint32_t WATCH = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO
+                              | IN_DELETE_SELF | IN_MOVE_SELF
+                              | IN_ONLYDIR | IN_DONT_FOLLOW | IN_EXCL_UNLINK;
+
+class listing_daemon
+{dir_tree& tree;
+ page_opts o;
+ const char* prog;
+ int ifd;
+ bool verbose;
+ unordered_map<int, size_t> node_of; // the dir_node of each watch
+ set<size_t> dirty;                  // directories whose page is out of date
+
+ // the watches of dirs[from..], as read() left them
+ void watched(size_t from)
+   {for(size_t k = from; k < tree.dirs.size(); k++)
+       {dir_node& n = tree.dirs[k];
+        if(n.watch >= 0) node_of[n.watch] = k;
+        dirty.insert(k);
+       }
+    report_errors(tree, from, prog);
+   }
+
+ // read the whole tree again, after the kernel dropped events; the pages
+ // of directories that have gone are removed
+ int rescan()
+   {vector<string> old;
+    for(const dir_node& n: tree.dirs) if(n.live) old.push_back(n.path);
+    for(auto& w: node_of) inotify_rm_watch(ifd, w.first);
+    node_of.clear();
+    dirty.clear();
+    if(tree.walk(tree.root().c_str(), o.nthreads) < 0) return -1;
+    watched(0);
+    set<string> now;
+    for(const dir_node& n: tree.dirs) now.insert(n.path);
+    // deepest first, so that their directories in outdir empty in turn
+    for(auto p = old.rbegin(); p != old.rend(); ++p)
+       if(!now.count(*p)) remove_page(o.outdir, *p);
+    return 0;
+   }
+
+ // one event; return -1 if the root itself has gone
+ int event(const inotify_event* e)
+   {if(e->mask & IN_Q_OVERFLOW)
+      {if(verbose) cerr << prog << ": events lost, reading the tree again" << endl;
+       return rescan();
+      }
+    auto w = node_of.find(e->wd);
+    if(w == node_of.end()) return 0;
+    size_t k = w->second;
+    if(e->mask & IN_IGNORED)
+      {node_of.erase(w);
+       return 0;
+      }
+    if(e->mask & (IN_DELETE_SELF | IN_MOVE_SELF))
+      return k == 0 ? -1 : 0; // below the root, the parent's event does the work
+    if(!tree.dirs[k].live || e->len == 0) return 0;
+    string_view name(e->name);
+    if(tree.skip && tree.skip(tree.dirs[k], name)) return 0; // a page of ours
+    if(e->mask & (IN_CREATE | IN_MOVED_TO))
+      {int32_t c = tree.insert(k, name, (e->mask & IN_ISDIR) != 0);
+       if(c >= 0)
+         {tree.read((size_t)c, o.nthreads);
+          watched((size_t)c);
+         }
+       dirty.insert(k);
+      }
+    else if(e->mask & (IN_DELETE | IN_MOVED_FROM))
+      {vector<size_t> gone;
+       if(tree.remove(k, name, &gone))
+         {for(auto g = gone.rbegin(); g != gone.rend(); ++g)
+             {dir_node& n = tree.dirs[*g];
+              if(n.watch >= 0)
+                {inotify_rm_watch(ifd, n.watch);
+                 node_of.erase(n.watch);
+                 n.watch = -1;
+                }
+              dirty.erase(*g);
+              remove_page(o.outdir, n.path);
+             }
+          dirty.insert(k);
+         }
+      }
+    return 0;
+   }
+
+ void flush()
+   {auto t0 = chrono::steady_clock::now();
+    long pages = write_pages(tree, vector<size_t>(dirty.begin(), dirty.end()), o, prog);
+    dirty.clear();
+    // once the removed directories outnumber the others, drop them and
+    // find the watched ones again (dirty is empty here), so a tree where
+    // directories come and go does not grow without bound
+    if(tree.dead_dirs() > tree.dirs.size() / 2)
+      {tree.prune();
+       node_of.clear();
+       for(size_t k = 0; k < tree.dirs.size(); k++)
+          if(tree.dirs[k].watch >= 0) node_of[tree.dirs[k].watch] = k;
+      }
+    if(verbose && pages >= 0)
+      cerr << prog << ": rewrote " << pages << " page(s) in "
+           << chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count()
+           << " ms" << endl;
+   }
+
+ public:
+ listing_daemon(dir_tree& t, const page_opts& opts, const char* p, bool v)
+   : tree(t), o(opts), prog(p), ifd(-1), verbose(v) {}
+ ~listing_daemon() {if(ifd >= 0) close(ifd);}
+
+ // read the tree, write all pages, then follow changes; returns only on
+ // an error, or when the root goes away
+ int run(const char* root, int debounce_ms)
+   {ifd = inotify_init1(IN_CLOEXEC);
+    if(ifd < 0) return -1;
+    // a directory is watched before it is read, so nothing made in it
+    // meanwhile is missed (an entry seen twice is inserted once)
+    tree.before_read = [this](dir_node& n)
+      {string p = tree.root();
+       if(!n.path.empty()) p += '/' + n.path;
+       n.watch = inotify_add_watch(ifd, p.c_str(), WATCH);
+      };
+    if(tree.walk(root, o.nthreads) < 0) return -1;
+    watched(0);
+    dirty.clear();
+    if(write_pages(tree, o, prog) < 0) return -1;
+
+    vector<char> buf(1 << 16);
+    auto first = chrono::steady_clock::now();
+    for(;;)
+      {int timeout = -1;
+       if(!dirty.empty())
+         {auto left = chrono::duration_cast<chrono::milliseconds>(
+                        first + chrono::milliseconds(10 * debounce_ms) - chrono::steady_clock::now());
+          timeout = (int)max<long long>(0, min<long long>(debounce_ms, left.count()));
+         }
+       pollfd p = {ifd, POLLIN, 0};
+       int r = poll(&p, 1, timeout);
+       if(r < 0)
+         {if(errno == EINTR) continue;
+          return -1;
+         }
+       if(r == 0)
+         {flush();
+          continue;
+         }
+       ssize_t got = read(ifd, buf.data(), buf.size());
+       if(got < 0)
+         {if(errno == EINTR) continue;
+          return -1;
+         }
+       bool was_clean = dirty.empty();
+       for(ssize_t off = 0; off < got; )
+          {const inotify_event* e = (const inotify_event*)(buf.data() + off);
+           off += sizeof(inotify_event) + e->len;
+           if(event(e) < 0)
+             {cerr << prog << ": " << tree.root() << " has gone" << endl;
+              return 0;
+             }
+          }
+       if(was_clean && !dirty.empty()) first = chrono::steady_clock::now();
+      }
+   }
+};
+
 int main(int argc, char *argv[])
 {basic_string<char> line;
- cout << "<html>" << endl;
- cout << "<h2>Directory listing</h2>" << endl;
- while(!cin.eof())
-   {
-    getline(cin, line);
-    cout << "<a href=\"" << line << "\">"
-         << line << "</a><br>" << endl;
-   }
- cout << "</html>" << endl;
+ int opt, nthreads = 0, debounce = 100, per_page = 0;
+ bool daemon = false, verbose = false, gz = false;
+ const char* outdir = nullptr;
+ const char* usage = " [-j threads] [directory]\n   or: makefilelist [-j threads] -o outdir"
+                     " [-n entries] [-z] [-d [-w ms] [-v]] directory";
+ while((opt = getopt(argc, argv, "j:o:n:zdw:v")) != -1)
+    switch(opt){
+    case 'j': nthreads = atoi(optarg); break;
+    case 'o': outdir = optarg; break;
+    case 'n': per_page = atoi(optarg); break;
+    case 'z': gz = true; break;
+    case 'd': daemon = true; break;
+    case 'w': debounce = atoi(optarg); break;
+    case 'v': verbose = true; break;
+    default:
+      cerr << "usage: " << argv[0] << usage << endl;
+      return 1;
+    }
+ if(optind < argc - 1 || ((outdir || daemon) && optind != argc - 1) || (daemon && !outdir)
+    || debounce < 0 || per_page < 0 || ((per_page || gz) && !outdir))
+   {cerr << "usage: " << argv[0] << usage << endl;
+    return 1;
+   }
+ page_opts o;
+ if(outdir) o.outdir = outdir;
+ o.per_page = (size_t)per_page;
+ o.gzip = gz;
+ o.nthreads = nthreads;
+
+ if(daemon)
+   {dir_tree tree;
+    if(skip_pages(tree, argv[optind], o.outdir) < 0)
+      {perror(outdir);
+       return 1;
+      }
+    listing_daemon d(tree, o, argv[0], verbose);
+    if(d.run(argv[optind], debounce) < 0)
+      {perror(argv[optind]);
+       return 1;
+      }
+    return 0;
+   }
+
+ if(optind == argc - 1)
+   {dir_tree tree;
+    if(outdir && skip_pages(tree, argv[optind], o.outdir) < 0)
+      {perror(outdir);
+       return 1;
+      }
+    if(tree.walk(argv[optind], nthreads) < 0)
+      {perror(argv[optind]);
+       return 1;
+      }
+    report_errors(tree, 0, argv[0]);
+    size_t blocked = 0;
+    if(outdir) return write_pages(tree, o, argv[0], &blocked) < 0 || blocked ? 1 : 0;
+
+    html_out out(1);
+    out.raw("<html>\n<h2>Directory listing</h2>\n");
+    tree.each([&](string_view path) {entry(out, path);});
+    out.raw("</html>\n");
+    if(out.flush() < 0)
+      {perror(argv[0]);
+       return 1;
+      }
+    return 0;
+   }
+
+ ios::sync_with_stdio(false);
+ html_out out(1);
+ out.raw("<html>\n<h2>Directory listing</h2>\n");
+ while(getline(cin, line)) entry(out, line);
+ out.raw("</html>\n");
+ if(out.flush() < 0)
+   {perror(argv[0]);
+    return 1;
+   }
  return 0;
 }
@@ -0,0 +1,104 @@
+// File: C++Examples/records.cpp
+// The loop of CExamples/scanf.c with the loader of records.h: the whole
+// input is parsed into columns first, then printed as scanf.c prints it,
+// with the format compiled in by format.h.
+// -c checks format.h instead: its output against snprintf's for a set
+// of formats and values, large values with long precisions among them.
+// run as "a.out scanf.i" or "a.out < scanf.i", or "a.out -c"
+// compile as "g++ -Wall -std=c++17 -O2 records.cpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+#include <string>
+#include <unistd.h>
+#include "records.h"
+#include "format.h"
+
+// the output of out.print(f, v), in a string
+template<class F, class T> static std::string format_of(F f, T v)
+{std::string s;
+ std::FILE* t = std::tmpfile();
+ if(t == nullptr) return s;
+ {outbuf out(t);
+  out.print(f, v);
+ }
+ std::rewind(t);
+ int c;
+ while((c = std::getc(t)) != EOF) s += (char)c;
+ std::fclose(t);
+ return s;
+}
+
+// -c: the number of fields that differ from snprintf's
+static int check_format()
+{static char want[2048];
+ int bad = 0, n = 0;
+ auto same = [&](const char* f, const std::string& got, int len)
+   {n++;
+    if(len < 0 || got != std::string(want, (std::size_t)len))
+      {bad++;
+       std::printf("WRONG %s: \"%s\" and snprintf \"%s\"\n", f, got.c_str(), want);
+      }
+   };
+#define CHECK(f, v) same(f, format_of(FMT(f), v), std::snprintf(want, sizeof(want), f, v))
+ const double xs[] = {0.0, -0.0, 0.5, 1.0, -2.5, 3.14159, 1e-300, 123456.789, 1e15,
+                      1e25, -1e25, 1e30, 9.999999e99, 1e200, 1.7976931348623157e308,
+                      5e-324, HUGE_VAL, -HUGE_VAL};
+ for(double x: xs)
+    {CHECK("%f", x); CHECK("%5.2f", x); CHECK("%+012.3f", x); CHECK("%.0f", x);
+     CHECK("%.110f", x); CHECK("%.300f", x); CHECK("%-40.20F", x);
+     CHECK("%e", x); CHECK("%.110e", x); CHECK("% E", x);
+     CHECK("%g", x); CHECK("%.110g", x); CHECK("%.3G", x);
+    }
+ const long long is[] = {0, 1, -1, 42, 70000, 300, -129, INT_MAX, INT_MIN,
+                         LLONG_MAX, LLONG_MIN};
+ for(long long i: is)
+    {CHECK("%lld", i); CHECK("%-8lld|", i); CHECK("%+.100lld", i); CHECK("%llx", i);
+     CHECK("%llo", i); CHECK("%020llX", i);
+     CHECK("%hd", (int)i); CHECK("%hhx", (int)i); CHECK("%hhd", (int)i); CHECK("%hu", (int)i);
+     CHECK("%hho", (unsigned)i); CHECK("%jd", (std::intmax_t)i); CHECK("%td", (std::ptrdiff_t)i);
+     CHECK("%lu", (unsigned long)i); CHECK("%llu", (unsigned long long)i); CHECK("%zx", (std::size_t)i);
+     CHECK("%lf", (double)i); CHECK("%.3le", (double)i);
+     CHECK("%ld", (long)i); CHECK("%zu", (std::size_t)i); CHECK("%c", (int)(i & 0x7f) | 32);
+    }
+ CHECK("%s", "records"); CHECK("%-10.3s|", "records"); CHECK("%10s", "");
+#undef CHECK
+ std::printf("format.h: %d of %d fields as snprintf writes them\n", n - bad, n);
+ return bad;
+}
+
+int main(int argc, char** argv)
+{mapped_file in;
+ records rec;
+
+ if(argc == 2 && std::strcmp(argv[1], "-c") == 0) return check_format() ? 1 : 0;
+ if((argc > 1 ? in.open(argv[1]) : in.open_fd(STDIN_FILENO)) < 0)
+   {std::perror(argc > 1 ? argv[1] : "stdin");
+    return 1;
+   }
+ records_status st = parse_records(in.data(), in.size(), rec);
+
+
+ {outbuf out(stdout);
+  for(std::size_t k = 0; k < rec.str.size(); k++)
+     out.print(FMT("Read string:\"%s\", integer:%d, float:%5.2f;%2u char's total\n"),
+               rec.str[k], rec.i[k], rec.x[k], rec.count[k]);
+ } // written out here
+
+ if(st.fields >= 0)
+   {std::fprintf(stderr, "In main(): scanf unable to decipher! ");
+    switch(st.fields){
+    case 2: std::fprintf(stderr, "read integer:%d", st.i_bad);
+    // fall through
+    case 1: std::fprintf(stderr, "read string:%.*s", (int)st.str_bad.size(),
+                         st.str_bad.data());
+    // fall through
+    default:std::fprintf(stderr, "\n");
+            std::exit(1); // indicate that an error occurred
+    } // end switch
+   }
+ return 0;
+}
@@ -0,0 +1,423 @@
+// File: C++Examples/records.h
+// Loads files of whitespace separated "string int double" records, the
+// input of CExamples/scanf.c, without scanf: the file is memory mapped
+// and parsed in place with std::from_chars into one array per column.
+// The strings are std::string_view's into the mapping, so a token of any
+// length is fine (scanf.c reads it into a char[20]) and nothing is copied.
+// The fields are read as glibc's scanf("%s%i%lf%n") would: the integer
+// is decimal, octal (leading 0) or hexadecimal (leading 0x), the double
+// decimal or hexadecimal (0x1.8p1), and each field ends where its syntax
+// ends, not at the next blank ("2.0" gives the int 2 and then the double
+// .0; "1e+x" gives 1 and leaves x).
+// parse_table() reads general tables the same way, one row per line and
+// on all cores, with "NA" (R) and "." (SAS) as missing values.
+// Needs C++17 (g++ -std=c++17, and -pthread for parse_table).
+
+#ifndef RECORDS_H
+#define RECORDS_H
+
+#include <charconv>
+#include <cmath>
+#include <string_view>
+#include <vector>
+#include <thread>
+#include <limits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <climits>
+#include <string>
+#include <cctype>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// a read-only view of a whole file; mapped when fd is a regular file,
+// read into memory otherwise (a pipe as stdin)
+class mapped_file
+{const char* p; std::size_t n;
+ bool mapped;
+ std::vector<char> copy;
+ public:
+ mapped_file() : p(nullptr), n(0), mapped(false) {}
+ mapped_file(const mapped_file&) = delete;
+ mapped_file& operator=(const mapped_file&) = delete;
+ ~mapped_file() {if(mapped) munmap(const_cast<char*>(p), n);}
+
+ // return 0, or -1 with errno set
+ int open_fd(int fd)
+   {struct stat st;
+    if(fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+      {void* m = mmap(nullptr, (std::size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+       if(m != MAP_FAILED)
+         {madvise(m, (std::size_t)st.st_size, MADV_SEQUENTIAL);
+          p = static_cast<const char*>(m); n = (std::size_t)st.st_size;
+          mapped = true;
+          return 0;
+         }
+      }
+    // not mappable: read it all
+    char buf[1 << 16];
+    ssize_t r;
+    while((r = read(fd, buf, sizeof(buf))) != 0)
+      {if(r < 0)
+         {if(errno == EINTR) continue;
+          return -1;
+         }
+       copy.insert(copy.end(), buf, buf + r);
+      }
+    p = copy.data(); n = copy.size();
+    return 0;
+   }
+ int open(const char* name)
+   {int fd = ::open(name, O_RDONLY);
+    if(fd < 0) return -1;
+    int r = open_fd(fd);
+    int e = errno;
+    close(fd); // the mapping stays valid
+    errno = e;
+    return r;
+   }
+ const char* data() const {return p;}
+ std::size_t size() const {return n;}
+};
+
+// the columns; row k is (str[k], i[k], x[k]), and count[k] is what "%n"
+// gives: the characters read for it, including the blanks in front
+struct records
+{std::vector<std::string_view> str;
+ std::vector<int> i;
+ std::vector<double> x;
+ std::vector<unsigned> count;
+};
+
+// where parsing stopped: fields is what scanf would return for the
+// failing record (0, 1 or 2; -1 at a clean end of input); for fields >= 1
+// str_bad/i_bad hold what was read of the record
+struct records_status
+{int fields;
+ std::size_t record;
+ std::string_view str_bad;
+ int i_bad;
+};
+
+namespace records_detail
+{
+inline bool is_space(char c)
+  {return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';}
+
+inline const char* skip_space(const char* p, const char* end)
+  {while(p < end && is_space(*p)) p++;
+   return p;
+  }
+
+// "%i": optional sign, then 0x.. hex, 0.. octal or decimal digits;
+// return the end of the number, or nullptr if there is none. As glibc's
+// scanf, a 0x is read even with no hex digit after it, and gives 0
+inline const char* parse_int(const char* p, const char* end, int& v)
+  {bool neg = false;
+   int base = 10;
+   if(p < end && (*p == '+' || *p == '-')) {neg = *p == '-'; p++;}
+   if(p < end && *p == '0')
+     {if(end - p > 1 && (p[1] == 'x' || p[1] == 'X')) {base = 16; p += 2;}
+      else base = 8;
+     }
+   unsigned long long u = 0;
+   auto r = std::from_chars(p, end, u, base);
+   if(r.ptr == p)
+     {if(base != 16) return nullptr;
+      v = 0;
+      return p;
+     }
+   // as glibc's scanf: strtol's long, clamped to LONG_MIN or LONG_MAX,
+   // then cut to an int (the standard leaves overflow undefined)
+   bool over = r.ec == std::errc::result_out_of_range;
+   long l;
+   if(neg) l = over || u > (unsigned long long)LONG_MAX + 1 ? LONG_MIN : (long)(0 - u);
+   else l = over || u > (unsigned long long)LONG_MAX ? LONG_MAX : (long)u;
+   v = (int)l;
+   return r.ptr;
+  }
+
+// "%lf": the characters glibc's scanf takes, which may be more than the
+// number (it cannot put back "e+" of "1e+x"), converted as strtod would:
+// an optional sign, then nan, inf or infinity, or decimal digits, or 0x
+// and hex digits, with at most one point and one exponent (e, or p for
+// hex) after a digit
+inline const char* parse_double(const char* p, const char* end, double& v)
+  {const char* s = p;
+   bool neg = false;
+   if(p < end && (*p == '+' || *p == '-')) {neg = *p == '-'; p++;}
+   auto word = [&](const char* w)
+     {std::size_t n = std::strlen(w);
+      if((std::size_t)(end - p) < n) return false;
+      for(std::size_t k = 0; k < n; k++)
+         if((p[k] | 32) != w[k]) return false;
+      p += n;
+      return true;
+     };
+   if(p < end && (*p | 32) == 'n')
+     {if(!word("nan")) return nullptr; // not "nan(chars)"
+      v = neg ? -std::numeric_limits<double>::quiet_NaN() : std::numeric_limits<double>::quiet_NaN();
+      return p;
+     }
+   if(p < end && (*p | 32) == 'i')
+     {if(!word("inf") || (p < end && (*p | 32) == 'i' && !word("inity"))) return nullptr;
+      v = neg ? -HUGE_VAL : HUGE_VAL;
+      return p;
+     }
+   bool hex = end - p > 1 && p[0] == '0' && (p[1] | 32) == 'x';
+   if(hex) p += 2;
+   const char* body = p;
+   char ex = hex ? 'p' : 'e';
+   bool digit = false, dot = false, e = false;
+   for(; p < end; p++)
+      if((*p >= '0' && *p <= '9') || (hex && !e && std::isxdigit((unsigned char)*p))) digit = true;
+      else if(e && (p[-1] | 32) == ex && (*p == '+' || *p == '-')) ;
+      else if(digit && !e && (*p | 32) == ex) e = dot = true;
+      else if(*p == '.' && !dot) dot = true;
+      else break;
+   if(hex ? p == body : !digit) return nullptr; // nothing strtod converts
+   std::from_chars_result r = std::from_chars(body, p, v, hex ? std::chars_format::hex
+                                                            : std::chars_format::general);
+   if(r.ptr == body) v = 0; // "0x."
+   // out of range, v is left alone: strtod gives +-HUGE_VAL, or 0 or a
+   // denormal, as scanf does
+   else if(r.ec == std::errc::result_out_of_range)
+     {v = std::strtod(std::string(s, p).c_str(), nullptr);
+      return p;
+     }
+   if(neg) v = -v;
+   return p;
+  }
+}
+
+// parse all records of [p, p+n) into rec (appending); the returned
+// status has fields == -1 if the whole input was read
+inline records_status parse_records(const char* p, std::size_t n, records& rec)
+{using namespace records_detail;
+ const char* end = p + n;
+ records_status st = {-1, 0, std::string_view(), 0};
+ for(;;)
+   {const char* start = p;
+    p = skip_space(p, end);
+    if(p == end) return st; // scanf's EOF
+    const char* s = p;
+    while(p < end && !is_space(*p)) p++;
+    std::string_view sv(s, (std::size_t)(p - s));
+
+    int iv;
+    const char* q = parse_int(skip_space(p, end), end, iv);
+    if(q == nullptr) {st.fields = 1; st.record = rec.str.size(); st.str_bad = sv; return st;}
+    p = q;
+
+    double xv;
+    q = parse_double(skip_space(p, end), end, xv);
+    if(q == nullptr)
+      {st.fields = 2; st.record = rec.str.size(); st.str_bad = sv; st.i_bad = iv;
+       return st;
+      }
+    p = q;
+
+    rec.str.push_back(sv);
+    rec.i.push_back(iv);
+    rec.x.push_back(xv);
+    rec.count.push_back((unsigned)(p - start));
+   }
+}
+
+// ---------- tables: one row per line, parsed in parallel ----------
+
+// a typed column: type 'i' fills i, 'd' fills x and 's' fills str (views
+// into the input); bit k of valid is 0 if row k was missing ("NA" or
+// "."), and then its value is 0, NaN or ""
+struct column
+{char type;
+ std::vector<int> i;
+ std::vector<double> x;
+ std::vector<std::string_view> str;
+ std::vector<std::uint64_t> valid;
+ std::size_t missing;
+ bool is_valid(std::size_t k) const {return valid[k >> 6] >> (k & 63) & 1;}
+};
+
+struct table
+{std::size_t rows;
+ std::vector<column> col;
+};
+
+// line is 0 if the whole input was read; else it is the first bad line
+// (counting from 1) and field the bad field in it (from 1; one past the
+// last column if the line is too long)
+struct table_status
+{std::size_t line;
+ int field;
+};
+
+namespace records_detail
+{
+// a piece of the input that starts at a line and ends after a '\n'
+struct chunk
+{const char* begin; const char* end;
+ std::size_t lines, rows;           // all lines, and the non-blank ones
+ std::size_t first_row;             // row number of its first row
+ std::vector<std::vector<std::size_t>> missing; // rows, per column
+ std::size_t bad_line, bad_row;     // bad_line 0 if all went well
+ int bad_field;
+};
+
+inline const char* line_end(const char* p, const char* end)
+  {const void* q = std::memchr(p, '\n', (std::size_t)(end - p));
+   return q ? static_cast<const char*>(q) : end;
+  }
+
+inline void count_rows(chunk& c)
+  {for(const char* p = c.begin; p < c.end; )
+     {const char* e = line_end(p, c.end);
+      c.lines++;
+      if(skip_space(p, e) < e) c.rows++;
+      p = e < c.end ? e + 1 : e;
+     }
+  }
+
+// the fields of one row; returns 0, or the number of the bad field
+inline int parse_row(const char* q, const char* e, std::size_t row,
+                     chunk& c, table& t)
+  {int ncol = (int)t.col.size();
+   for(int f = 0; f < ncol; f++)
+      {q = skip_space(q, e);
+       if(q == e) return f + 1; // too short
+       const char* s = q;
+       while(q < e && !is_space(*q)) q++;
+       column& col = t.col[f];
+       if((q - s == 2 && s[0] == 'N' && s[1] == 'A') || (q - s == 1 && s[0] == '.'))
+         {c.missing[f].push_back(row);
+          if(col.type == 'i') col.i[row] = 0;
+          else if(col.type == 'd') col.x[row] = std::numeric_limits<double>::quiet_NaN();
+          continue; // and str[row] stays empty
+         }
+       const char* r;
+       switch(col.type){
+       case 'i': r = parse_int(s, q, col.i[row]); break;
+       case 'd': r = parse_double(s, q, col.x[row]); break;
+       default:  col.str[row] = std::string_view(s, (std::size_t)(q - s)); r = q;
+       }
+       if(r != q) return f + 1; // not a number, or junk after it
+      }
+   return skip_space(q, e) < e ? ncol + 1 : 0;
+  }
+
+inline void parse_chunk(chunk& c, table& t)
+  {std::size_t row = c.first_row, line = 0;
+   for(const char* p = c.begin; p < c.end; )
+     {const char* e = line_end(p, c.end);
+      const char* q = skip_space(p, e);
+      line++;
+      if(q < e)
+        {int f = parse_row(q, e, row, c, t);
+         if(f != 0)
+           {c.bad_line = line; c.bad_row = row; c.bad_field = f;
+            return;
+           }
+         row++;
+        }
+      p = e < c.end ? e + 1 : e;
+     }
+  }
+
+// f(0), ..., f(n-1), each in its own thread
+template<class F> void run_chunks(int n, F f)
+  {std::vector<std::thread> th;
+   for(int k = 1; k < n; k++) th.emplace_back(f, k);
+   f(0);
+   for(auto& x: th) x.join();
+  }
+}
+
+// parse [p, p+n) as a table with one column per letter of types ('i' int
+// as "%i", 'd' double, 's' string), one row per non-blank line, using
+// nthreads threads (0: one per core). The input is cut into pieces at
+// line ends; a first pass counts the rows of each piece, so that the
+// second can parse straight into the final rows of the columns.
+// On error t holds the rows before the bad line.
+inline table_status parse_table(const char* p, std::size_t n, const char* types,
+                                table& t, int nthreads = 0)
+{using namespace records_detail;
+ const char* end = p + n;
+ int ncol = (int)std::strlen(types);
+
+ if(nthreads <= 0) nthreads = (int)std::thread::hardware_concurrency();
+ if(nthreads <= 0) nthreads = 1;
+ if((std::size_t)nthreads > n / (1 << 16) + 1) nthreads = (int)(n / (1 << 16) + 1);
+
+ std::vector<chunk> ch((std::size_t)nthreads);
+ const char* b = p;
+ for(int k = 0; k < nthreads; k++)
+    {chunk& c = ch[k];
+     const char* e = k == nthreads - 1 ? end : p + n / nthreads * (k + 1);
+     if(e < b) e = b;
+     if(e < end) e = line_end(e, end);
+     if(e < end) e++;
+     c.begin = b; c.end = e; b = e;
+     c.lines = c.rows = c.first_row = 0;
+     c.missing.resize((std::size_t)ncol);
+     c.bad_line = c.bad_row = 0; c.bad_field = 0;
+    }
+
+ run_chunks(nthreads, [&](int k) {count_rows(ch[k]);});
+ std::size_t rows = 0;
+ for(chunk& c: ch) {c.first_row = rows; rows += c.rows;}
+
+ t.rows = rows;
+ t.col.assign((std::size_t)ncol, column());
+ for(int f = 0; f < ncol; f++)
+    {column& col = t.col[f];
+     col.type = types[f];
+     if(col.type == 'i') col.i.resize(rows);
+     else if(col.type == 'd') col.x.resize(rows);
+     else col.str.resize(rows);
+     col.valid.assign((rows + 63) / 64, ~(std::uint64_t)0);
+     if(rows % 64 != 0) col.valid.back() = ((std::uint64_t)1 << rows % 64) - 1;
+     col.missing = 0;
+    }
+
+ run_chunks(nthreads, [&](int k) {parse_chunk(ch[k], t);});
+
+ // the first error in file order, if any
+ table_status st = {0, 0};
+ std::size_t line = 0;
+ for(chunk& c: ch)
+    {if(c.bad_line != 0)
+       {st.line = line + c.bad_line; st.field = c.bad_field;
+        rows = c.bad_row;
+        break;
+       }
+     line += c.lines;
+    }
+
+ // the missing rows, which are few, are cleared one by one
+ for(chunk& c: ch)
+    for(int f = 0; f < ncol; f++)
+       for(std::size_t r: c.missing[f])
+          if(r < rows)
+            {t.col[f].valid[r >> 6] &= ~((std::uint64_t)1 << (r & 63));
+             t.col[f].missing++;
+            }
+
+ if(rows < t.rows)
+   {t.rows = rows;
+    for(column& col: t.col)
+       {if(col.type == 'i') col.i.resize(rows);
+        else if(col.type == 'd') col.x.resize(rows);
+        else col.str.resize(rows);
+        col.valid.resize((rows + 63) / 64);
+        if(rows % 64 != 0) col.valid.back() &= ((std::uint64_t)1 << rows % 64) - 1;
+       }
+   }
+ return st;
+}
+
+#endif // RECORDS_H
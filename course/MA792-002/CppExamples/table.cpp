@@ -0,0 +1,94 @@
+// File: C++Examples/table.cpp
+// Reads a whitespace separated table, one row per line, into typed
+// columns with parse_table() of records.h, on all cores, and prints a
+// summary of each column. "NA" and "." are missing values.
+// run as "a.out [-j threads] [-t types] file", e.g.
+//        "a.out -t iididd ../../st790/hwk/cd4.dat"
+//        "a.out ../../st790_missing/examples/bvnormal.dat"
+// types has a letter per column: i int, d double, s string; without it
+// all columns are doubles, as many as the first row has. The summary is
+// printed through format.h.
+// compile as "g++ -Wall -std=c++17 -O2 -pthread table.cpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <string>
+#include <chrono>
+#include <unistd.h>
+#include "records.h"
+#include "format.h"
+
+int main(int argc, char** argv)
+{int nthreads = 0, opt;
+ std::string types;
+ mapped_file in;
+ table t;
+
+ while((opt = getopt(argc, argv, "j:t:")) != -1)
+    switch(opt){
+    case 'j': nthreads = std::atoi(optarg); break;
+    case 't': types = optarg; break;
+    default:  std::fprintf(stderr, "usage: %s [-j threads] [-t types] file\n", argv[0]);
+              return 1;
+    }
+ if(optind != argc - 1)
+   {std::fprintf(stderr, "usage: %s [-j threads] [-t types] file\n", argv[0]);
+    return 1;
+   }
+ if(in.open(argv[optind]) < 0)
+   {std::perror(argv[optind]);
+    return 1;
+   }
+ if(types.empty())
+   {// count the fields of the first row
+    const char* p = in.data();
+    const char* end = p + in.size();
+    p = records_detail::skip_space(p, end);
+    const char* e = records_detail::line_end(p, end);
+    while(p < e)
+      {while(p < e && !records_detail::is_space(*p)) p++;
+       types += 'd';
+       p = records_detail::skip_space(p, e);
+      }
+   }
+ if(types.empty() || types.find_first_not_of("ids") != std::string::npos)
+   {std::fprintf(stderr, "%s: bad column types \"%s\"\n", argv[0], types.c_str());
+    return 1;
+   }
+
+ auto start = std::chrono::steady_clock::now();
+ table_status st = parse_table(in.data(), in.size(), types.c_str(), t, nthreads);
+ std::chrono::duration<double> sec = std::chrono::steady_clock::now() - start;
+ std::fprintf(stderr, "%.1f MB in %.3f s\n", in.size() * 1e-6, sec.count());
+ if(st.line != 0)
+   std::fprintf(stderr, "%s:%zu: cannot read field %d; using the %zu rows before it\n",
+                argv[optind], st.line, st.field, t.rows);
+
+ outbuf out(stdout);
+ out.print(FMT("%zu rows, %zu columns\n"), t.rows, t.col.size());
+ for(std::size_t f = 0; f < t.col.size(); f++)
+    {const column& c = t.col[f];
+     out.print(FMT("%3zu %-6s %10zu NA"), f + 1,
+                 c.type == 'i' ? "int" : c.type == 'd' ? "double" : "string",
+                 c.missing);
+     if(c.type == 's')
+       {std::size_t len = 0;
+        for(std::size_t k = 0; k < t.rows; k++) len += c.str[k].size();
+        out.print(FMT("  mean length %.2f\n"), t.rows > c.missing ? (double)len / (t.rows - c.missing) : 0.0);
+        continue;
+       }
+     double sum = 0, lo = HUGE_VAL, hi = -HUGE_VAL, v;
+     for(std::size_t k = 0; k < t.rows; k++)
+        if(c.is_valid(k))
+          {v = c.type == 'i' ? c.i[k] : c.x[k];
+           sum += v;
+           if(v < lo) lo = v;
+           if(v > hi) hi = v;
+          }
+     if(t.rows > c.missing)
+       out.print(FMT("  mean %-12.6g min %-12.6g max %.6g\n"), sum / (t.rows - c.missing), lo, hi);
+     else out.print(FMT("\n"));
+    }
+ return st.line != 0;
+}
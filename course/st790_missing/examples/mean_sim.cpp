@@ -0,0 +1,225 @@
+// File: st790_missing/examples/mean_sim.cpp
+// The simulation of mean_sim.R without R, for several missingness
+// scenarios at once: S data sets of N rows from generate(N,psi), and
+// for each the full data, complete case and two inverse probability
+// weighted means of y and the proportion observed, summarized by their
+// means, standard deviations, biases and mean squared errors.
+// The replicates of all the scenarios run in parallel, in blocks of 64.
+// Replicate s of scenario k draws from its own xoshiro256** stream,
+// seeded from (seed, k, s), so the results do not depend on the number
+// of threads or on the order the blocks run in; the running sums of
+// each block are merged in order at the end. Each thread generates its
+// data sets in the same arrays, allocated once.
+// The true mean of y is computed exactly,
+//   exp(2.3 + (0.5^2 + 0.5^2)/2) (0.5 + 0.5 e) = 23.8102...,
+// instead of from a million draws as in the R script.
+// run as "mean_sim [-S reps] [-N n] [-s seed] [-j threads] [scenario...]"
+//   a scenario is mcar, mar or mnar, the psi of the R script, or psi
+//   itself as four numbers separated by commas, e.g. 0.8,-1.4,0.5,0;
+//   the default is all three of the R script
+// compile as
+//   "gcc -c -Wall -std=c99 -O2 -march=native ../../MA792-002/CExamples/sample.c"
+//   "g++ -Wall -std=c++17 -O2 -pthread -iquote ../../MA792-002/CExamples mean_sim.cpp sample.o -lm"
+// (-iquote, not -I: MA792-002/CExamples has a stdlib.h of its own)
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "sample.h"
+
+enum {FULL, CC, IPW, IPW_ALT, POBS, NSTATS};
+static const char* const stat_name[] = {"full", "cc", "ipw", "ipw.alt", "pobs"};
+
+static const int BLOCK = 64; // replicates per job
+
+// the parameters of generate() in mean_sim.R
+static const double pv = 0.5, theta[] = {2.3, 0.5, 1}, sigma = 0.5;
+
+struct scenario
+{std::string name;
+ double psi[4];
+};
+
+// running mean and sum of squared deviations, by Welford's method;
+// two of them merge as in Chan, Golub and LeVeque (1983)
+struct running
+{double n = 0, mean = 0, m2 = 0;
+
+ void add(double x)
+ {if(std::isnan(x)) return; // a data set with no y observed
+  n++;
+  double d = x - mean;
+  mean += d / n;
+  m2 += d * (x - mean);
+ }
+ void merge(const running& o)
+ {if(o.n == 0) return;
+  double nn = n + o.n, d = o.mean - mean;
+  mean += d * o.n / nn;
+  m2 += o.m2 + d * d * n * o.n / nn;
+  n = nn;
+ }
+ // NaN, as sd() with fewer than 2, if every value was dropped
+ double average() const {return n > 0 ? mean : NAN;}
+ double sd() const {return n > 1 ? std::sqrt(m2 / (n - 1)) : NAN;}
+ // the mean of (x - t)^2
+ double mse(double t) const {return n > 0 ? m2 / n + (mean - t) * (mean - t) : NAN;}
+};
+
+// the arrays of one data set, reused by each replicate a thread runs
+struct arena
+{std::vector<double> v1, e, y, eta, pi;
+ std::vector<int> v2, c;
+
+ explicit arena(std::size_t n): v1(n), e(n), y(n), eta(n), pi(n), v2(n), c(n) {}
+};
+
+// one replicate: generate(N,psi) into a, then the estimators into r
+static void replicate(xoshiro256* g, const scenario& sc, std::size_t n, arena& a, running* r)
+{const double* psi = sc.psi;
+ sample_normal(g, a.v1.data(), n, 0, 1);
+ sample_binomial(g, a.v2.data(), n, 1, pv);
+ sample_normal(g, a.e.data(), n, 0, sigma);
+ for(std::size_t i = 0; i < n; i++)
+    {a.y[i] = std::exp(theta[0] + theta[1] * a.v1[i] + theta[2] * a.v2[i] + a.e[i]);
+     a.eta[i] = psi[0] + psi[1] * a.v1[i] + psi[2] * a.v2[i] + psi[3] * a.y[i];
+    }
+ sample_bernoulli_logit(g, a.c.data(), a.pi.data(), a.eta.data(), n);
+
+ double sy = 0, scy = 0, nobs = 0, sw = 0, swy = 0;
+ for(std::size_t i = 0; i < n; i++)
+    {sy += a.y[i];
+     if(a.c[i])
+       {nobs++;
+        scy += a.y[i];
+        sw += 1 / a.pi[i];
+        swy += a.y[i] / a.pi[i];
+       }
+    }
+ r[FULL].add(sy / n);
+ r[CC].add(nobs > 0 ? scy / nobs : NAN);
+ r[IPW].add(swy / n);
+ r[IPW_ALT].add(sw > 0 ? swy / sw : NAN);
+ r[POBS].add(nobs / n);
+}
+
+static int parse_scenario(const char* s, scenario& sc)
+{static const scenario named[] = {{"mcar", {1.0, 0, 0, 0}},
+                                  {"mar", {0.8, -1.4, 0.5, 0}},
+                                  {"mnar", {1.5, 0, 0, -0.05}}};
+ for(const scenario& n: named)
+    if(std::strcmp(s, n.name.c_str()) == 0)
+      {sc = n;
+       return 0;
+      }
+ sc.name = s;
+ char* end = (char*)s;
+ for(int k = 0; k < 4; k++)
+    {const char* p = end;
+     sc.psi[k] = std::strtod(p, &end);
+     if(end == p || *end != (k < 3 ? ',' : '\0')) return -1;
+     if(k < 3) end++;
+    }
+ return 0;
+}
+
+int main(int argc, char** argv)
+{int opt, nthreads = 0;
+ long nrep = 1000, n = 100;
+ unsigned long long seed = 4;
+
+ while((opt = getopt(argc, argv, "S:N:s:j:")) != -1)
+    switch(opt){
+    case 'S': nrep = std::atol(optarg); break;
+    case 'N': n = std::atol(optarg); break;
+    case 's': seed = std::strtoull(optarg, nullptr, 0); break;
+    case 'j': nthreads = std::atoi(optarg); break;
+    default:
+      std::fprintf(stderr, "usage: %s [-S reps] [-N n] [-s seed] [-j threads] [scenario...]\n",
+                   argv[0]);
+      return 1;
+    }
+ if(nrep < 1 || n < 1)
+   {std::fprintf(stderr, "%s: -S and -N must be positive\n", argv[0]);
+    return 1;
+   }
+
+ std::vector<scenario> sc;
+ if(optind == argc)
+   for(const char* s: {"mcar", "mar", "mnar"})
+      {sc.emplace_back();
+       parse_scenario(s, sc.back());
+      }
+ for(int a = optind; a < argc; a++)
+    {sc.emplace_back();
+     if(parse_scenario(argv[a], sc.back()) < 0)
+       {std::fprintf(stderr, "%s: %s is not mcar, mar, mnar or psi1,psi2,psi3,psi4\n",
+                     argv[0], argv[a]);
+        return 1;
+       }
+    }
+
+ // the jobs, scenario by scenario: a block of replicates each, with
+ // its own sums
+ std::size_t nblocks = (nrep + BLOCK - 1) / BLOCK, njobs = sc.size() * nblocks;
+ std::vector<running> sums(njobs * NSTATS);
+ std::atomic<std::size_t> next(0);
+ auto work = [&]
+   {arena a(n);
+    for(std::size_t k; (k = next++) < njobs; )
+       {std::size_t j = k / nblocks, b = k % nblocks;
+        long s1 = std::min<long>(nrep, (long)(b + 1) * BLOCK);
+        for(long s = (long)b * BLOCK; s < s1; s++)
+           {xoshiro256 g;
+            xoshiro256_seed(&g, seed + 0x9e3779b97f4a7c15ULL * (j * (unsigned long long)nrep + s));
+            replicate(&g, sc[j], n, a, &sums[k * NSTATS]);
+           }
+       }
+   };
+ if(nthreads <= 0) nthreads = (int)std::thread::hardware_concurrency();
+ if(nthreads <= 0) nthreads = 1;
+ if((std::size_t)nthreads > njobs) nthreads = (int)njobs;
+ auto t0 = std::chrono::steady_clock::now();
+ std::vector<std::thread> th;
+ for(int k = 1; k < nthreads; k++) th.emplace_back(work);
+ work();
+ for(auto& x: th) x.join();
+ double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+ double truth = std::exp(theta[0] + (theta[1] * theta[1] + sigma * sigma) / 2)
+                * (1 - pv + pv * std::exp(theta[2]));
+ for(std::size_t j = 0; j < sc.size(); j++)
+    {running r[NSTATS];
+     for(std::size_t b = 0; b < nblocks; b++)
+        for(int i = 0; i < NSTATS; i++) r[i].merge(sums[(j * nblocks + b) * NSTATS + i]);
+
+     const double* psi = sc[j].psi;
+     std::printf("%s: psi %g %g %g %g, N %ld, S %ld, true mean %.6f\n", sc[j].name.c_str(),
+                 psi[0], psi[1], psi[2], psi[3], n, nrep, truth);
+     std::printf("       ");
+     for(int i = 0; i < NSTATS; i++) std::printf(" %10s", stat_name[i]);
+     std::printf("\nmeans  ");
+     for(int i = 0; i < NSTATS; i++) std::printf(" %10.6f", r[i].average());
+     std::printf("\nsds    ");
+     for(int i = 0; i < NSTATS; i++) std::printf(" %10.6f", r[i].sd());
+     std::printf("\nbias   ");
+     for(int i = 0; i < POBS; i++) std::printf(" %10.6f", r[i].average() - truth);
+     std::printf("\nmses   ");
+     for(int i = 0; i < POBS; i++) std::printf(" %10.6f", r[i].mse(truth));
+     std::printf("\n");
+     if(r[CC].n < nrep)
+       std::printf("(%.0f data sets with no y observed left out of cc and ipw.alt)\n",
+                   nrep - r[CC].n);
+     std::printf("\n");
+    }
+ std::printf("%zu replicates in %.3f s on %d threads\n", sc.size() * nrep, sec, nthreads);
+ return 0;
+}
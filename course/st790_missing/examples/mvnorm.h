@@ -0,0 +1,467 @@
+// File: st790_missing/examples/mvnorm.h
+// Multivariate normal data with missing values, for the EM algorithm of
+// em.norm in Schafer's norm package (see norm_em.R).
+//
+// As in prelim.norm, each column is standardized by the mean and the
+// standard deviation of its observed values, and the rows are sorted by
+// their pattern of missingness. For each pattern the sums of the
+// observed values and of their cross products are formed once, with the
+// kernels of blas.h, so that an iteration of EM costs a few small
+// matrix operations per pattern, not a pass over the data. The sums may
+// weight the rows, e.g. by how often a bootstrap sample drew them.
+//
+// Parameters are on the standardized scale: mu[j] and sigma[j*p+k];
+// mvn_data::original() converts them back. The EM iteration stops, as
+// em.norm does, when no element of mu or sigma moves by more than the
+// criterion.
+//
+// The data augmentation of da.norm (see norm_mi.R) alternates an I-step,
+// which draws the missing values of each row from their normal
+// distribution given its observed values, and a P-step, which draws mu
+// and sigma from their posterior under the noninformative prior given
+// the completed data. A chain keeps only the missing values it drew, in
+// the order of the sorted rows and, within a row, of its pattern's mis.
+// Needs C++17 and, compiled with gcc, blas.c and matrix.c of
+// MA792-002/CExamples, and sample.c for the data augmentation.
+
+#ifndef MVNORM_H
+#define MVNORM_H
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <new>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+#include "matrix.h"
+#include "blas.h"
+#include "xoshiro.h"
+#include "sample.h"
+
+// the rows with one pattern: the columns observed and missing, and the
+// observed values of its rows, count x obs.size(), in a matrix
+struct mvn_pattern
+{std::vector<int> obs, mis;
+ std::size_t first, count; // its rows among the sorted rows
+ matrix x;
+};
+
+struct mvn_theta
+{std::vector<double> mu, sigma;
+};
+
+class mvn_data
+{public:
+ std::size_t n;
+ int p;
+ std::vector<double> xbar, sdv;     // the standardization
+ std::vector<std::size_t> row;      // the data row of each sorted row
+ std::vector<mvn_pattern> pat;
+
+ // x[i*stride+j] is row i, column j, NaN when missing;
+ // throws std::bad_alloc if out of memory
+ mvn_data(const double* x, std::size_t rows, int cols, std::size_t stride)
+   : n(rows), p(cols), xbar(cols, 0.0), sdv(cols, 1.0), row(rows)
+   {// mean and standard deviation of the observed values
+    for(int j = 0; j < p; j++)
+       {double s = 0, ss = 0;
+        std::size_t m = 0;
+        for(std::size_t i = 0; i < n; i++)
+           if(!std::isnan(x[i*stride+j])) {s += x[i*stride+j]; m++;}
+        if(m > 0) xbar[j] = s / m;
+        for(std::size_t i = 0; i < n; i++)
+           if(!std::isnan(x[i*stride+j]))
+             ss += (x[i*stride+j] - xbar[j]) * (x[i*stride+j] - xbar[j]);
+        if(m > 1 && ss > 0) sdv[j] = std::sqrt(ss / (m - 1));
+       }
+
+    // sort the rows by pattern
+    std::vector<std::string> key(n, std::string((std::size_t)p, '1'));
+    for(std::size_t i = 0; i < n; i++)
+       for(int j = 0; j < p; j++)
+          if(std::isnan(x[i*stride+j])) key[i][j] = '0';
+    std::iota(row.begin(), row.end(), (std::size_t)0);
+    std::stable_sort(row.begin(), row.end(),
+                     [&](std::size_t a, std::size_t b) {return key[a] > key[b];});
+
+    for(std::size_t i = 0; i < n; )
+       {std::size_t e = i;
+        while(e < n && key[row[e]] == key[row[i]]) e++;
+        pat.emplace_back();
+        mvn_pattern& q = pat.back();
+        q.first = i; q.count = e - i;
+        for(int j = 0; j < p; j++) (key[row[i]][j] == '1' ? q.obs : q.mis).push_back(j);
+        if(matrix_alloc(&q.x, MATRIX_DOUBLE, q.count, q.obs.size()) != 0)
+          throw std::bad_alloc();
+        for(std::size_t r = 0; r < q.count; r++)
+           for(std::size_t o = 0; o < q.obs.size(); o++)
+              {int j = q.obs[o];
+               MATRIX_D(&q.x, r, o) = (x[row[i+r]*stride+j] - xbar[j]) / sdv[j];
+              }
+        i = e;
+       }
+   }
+ mvn_data(const mvn_data&) = delete;
+ mvn_data& operator=(const mvn_data&) = delete;
+ ~mvn_data() {for(mvn_pattern& q: pat) matrix_free(&q.x);}
+
+ // theta on the scale of the data
+ mvn_theta original(const mvn_theta& t) const
+   {mvn_theta o = t;
+    for(int j = 0; j < p; j++)
+       {o.mu[j] = t.mu[j] * sdv[j] + xbar[j];
+        for(int k = 0; k < p; k++) o.sigma[j*p+k] = t.sigma[j*p+k] * sdv[j] * sdv[k];
+       }
+    return o;
+   }
+};
+
+// the sufficient statistics of the observed values, per pattern
+struct mvn_stats
+{double total;                          // sum of the weights
+ std::vector<double> w;                 // per pattern
+ std::vector<std::vector<double>> s;    // sum of x_obs
+ std::vector<std::vector<double>> ss;   // sum of x_obs x_obs', row major
+
+ // weight[i] for sorted row i, or all 1 if weight is NULL;
+ // throws std::bad_alloc if out of memory
+ mvn_stats(const mvn_data& d, const double* weight = nullptr)
+   : total(0), w(d.pat.size()), s(d.pat.size()), ss(d.pat.size())
+   {for(std::size_t g = 0; g < d.pat.size(); g++)
+       {const mvn_pattern& q = d.pat[g];
+        std::size_t no = q.obs.size();
+        const double* wt = weight ? weight + q.first : nullptr;
+        w[g] = 0;
+        for(std::size_t r = 0; r < q.count; r++) w[g] += wt ? wt[r] : 1;
+        total += w[g];
+        s[g].assign(no, 0.0);
+        ss[g].assign(no * no, 0.0);
+        if(no == 0 || q.count == 0) continue;
+
+        // with Y' the weighted rows as columns: s = Y' 1, ss = Y' X
+        matrix yt, c;
+        std::vector<double> one(q.count, 1.0);
+        if(matrix_alloc(&yt, MATRIX_DOUBLE, no, q.count) != 0) throw std::bad_alloc();
+        if(matrix_alloc(&c, MATRIX_DOUBLE, no, no) != 0)
+          {matrix_free(&yt);
+           throw std::bad_alloc();
+          }
+        for(std::size_t r = 0; r < q.count; r++)
+           for(std::size_t o = 0; o < no; o++)
+              MATRIX_D(&yt, o, r) = (wt ? wt[r] : 1) * MATRIX_D(&q.x, r, o);
+        blas_dgemv(1, &yt, one.data(), 0, s[g].data());
+        blas_gemm(1, &yt, &q.x, 0, &c, 1);
+        for(std::size_t o = 0; o < no; o++)
+           for(std::size_t k = 0; k < no; k++) ss[g][o*no+k] = MATRIX_D(&c, o, k);
+        matrix_free(&yt);
+        matrix_free(&c);
+       }
+   }
+};
+
+// sweep the p x p symmetric matrix g on k (Goodnight, 1979)
+inline void mvn_sweep(std::vector<double>& g, int p, int k)
+{double h = g[k*p+k];
+ for(int i = 0; i < p; i++)
+    if(i != k)
+      for(int j = 0; j < p; j++)
+         if(j != k) g[i*p+j] -= g[i*p+k] * g[k*p+j] / h;
+ for(int i = 0; i < p; i++)
+    if(i != k) {g[i*p+k] /= h; g[k*p+i] /= h;}
+ g[k*p+k] = -1 / h;
+}
+
+// em.norm's default start: mean 0 and identity covariance
+inline mvn_theta mvn_start(const mvn_data& d)
+{mvn_theta t;
+ t.mu.assign(d.p, 0.0);
+ t.sigma.assign((std::size_t)d.p * d.p, 0.0);
+ for(int j = 0; j < d.p; j++) t.sigma[j*d.p+j] = 1;
+ return t;
+}
+
+// the complete cases' mean and covariance (divisor n-1), the start of
+// bvnormal_em.R; the default start if there are fewer than two
+inline mvn_theta mvn_start_cc(const mvn_data& d, const mvn_stats& st)
+{for(std::size_t g = 0; g < d.pat.size(); g++)
+    if(d.pat[g].mis.empty() && st.w[g] > 1)
+      {int p = d.p;
+       double m = st.w[g];
+       mvn_theta t;
+       t.mu.resize(p);
+       t.sigma.resize((std::size_t)p * p);
+       for(int j = 0; j < p; j++) t.mu[j] = st.s[g][j] / m;
+       for(int j = 0; j < p; j++)
+          for(int k = 0; k < p; k++)
+             t.sigma[j*p+k] = (st.ss[g][j*p+k] - m * t.mu[j] * t.mu[k]) / (m - 1);
+       return t;
+      }
+ return mvn_start(d);
+}
+
+// one EM step from t to u
+inline void mvn_em_step(const mvn_data& d, const mvn_stats& st,
+                        const mvn_theta& t, mvn_theta& u)
+{int p = d.p;
+ std::vector<double> t1(p, 0.0), t2((std::size_t)p * p, 0.0), g, a, bs;
+ for(std::size_t k = 0; k < d.pat.size(); k++)
+    {const mvn_pattern& q = d.pat[k];
+     const std::vector<double>& s = st.s[k];
+     const std::vector<double>& ss = st.ss[k];
+     double w = st.w[k];
+     int no = (int)q.obs.size(), nm = (int)q.mis.size();
+     if(w == 0) continue;
+     for(int o = 0; o < no; o++)
+        {t1[q.obs[o]] += s[o];
+         for(int r = 0; r < no; r++) t2[q.obs[o]*p+q.obs[r]] += ss[o*no+r];
+        }
+     if(nm == 0) continue;
+
+     // the regression of the missing on the observed columns:
+     // B = g[mis][obs] and its residual covariance C = g[mis][mis]
+     g = t.sigma;
+     for(int o = 0; o < no; o++) mvn_sweep(g, p, q.obs[o]);
+     auto B = [&](int m, int o) {return g[q.mis[m]*p+q.obs[o]];};
+     auto C = [&](int m, int l) {return g[q.mis[m]*p+q.mis[l]];};
+
+     // E x_mis = a + B x_obs with a = mu_mis - B mu_obs
+     a.assign(nm, 0.0);
+     bs.assign(nm, 0.0);
+     for(int m = 0; m < nm; m++)
+        {a[m] = t.mu[q.mis[m]];
+         for(int o = 0; o < no; o++)
+            {a[m] -= B(m, o) * t.mu[q.obs[o]];
+             bs[m] += B(m, o) * s[o];
+            }
+        }
+     for(int m = 0; m < nm; m++)
+        {int i = q.mis[m];
+         t1[i] += w * a[m] + bs[m];
+         // x_mis x_obs'
+         for(int o = 0; o < no; o++)
+            {double v = a[m] * s[o];
+             for(int r = 0; r < no; r++) v += B(m, r) * ss[r*no+o];
+             t2[i*p+q.obs[o]] += v;
+             t2[q.obs[o]*p+i] += v;
+            }
+         // x_mis x_mis'
+         for(int l = 0; l < nm; l++)
+            {double v = w * (a[m] * a[l] + C(m, l)) + a[m] * bs[l] + bs[m] * a[l];
+             for(int o = 0; o < no; o++)
+                for(int r = 0; r < no; r++) v += B(m, o) * ss[o*no+r] * B(l, r);
+             t2[i*p+q.mis[l]] += v;
+            }
+        }
+    }
+ u.mu.resize(p);
+ u.sigma.resize((std::size_t)p * p);
+ for(int j = 0; j < p; j++) u.mu[j] = t1[j] / st.total;
+ for(int j = 0; j < p; j++)
+    for(int k = 0; k < p; k++)
+       u.sigma[j*p+k] = t2[j*p+k] / st.total - u.mu[j] * u.mu[k];
+}
+
+// EM from t until no parameter moves by more than criterion, or for
+// maxits iterations; return the iterations done
+inline int mvn_em(const mvn_data& d, const mvn_stats& st, mvn_theta& t,
+                  int maxits = 1000, double criterion = 1e-4)
+{mvn_theta u;
+ int it = 0;
+ double change = HUGE_VAL;
+ while(change > criterion && it < maxits)
+   {mvn_em_step(d, st, t, u);
+    change = 0;
+    for(int j = 0; j < d.p; j++)
+       {change = std::max(change, std::fabs(u.mu[j] - t.mu[j]));
+        for(int k = j; k < d.p; k++)
+           change = std::max(change, std::fabs(u.sigma[j*d.p+k] - t.sigma[j*d.p+k]));
+       }
+    std::swap(t, u);
+    it++;
+   }
+ return it;
+}
+
+// ---------- data augmentation ----------
+
+// the number of missing values
+inline std::size_t mvn_nmis(const mvn_data& d)
+{std::size_t m = 0;
+ for(const mvn_pattern& q: d.pat) m += q.count * q.mis.size();
+ return m;
+}
+
+// the lower triangular L with L L' = a, in place, for the n x n
+// symmetric a; return false if a is not positive definite
+inline bool mvn_chol(std::vector<double>& a, int n)
+{for(int j = 0; j < n; j++)
+    {double h = a[j*n+j];
+     for(int k = 0; k < j; k++) h -= a[j*n+k] * a[j*n+k];
+     if(!(h > 0)) return false;
+     h = std::sqrt(h);
+     a[j*n+j] = h;
+     for(int i = j + 1; i < n; i++)
+        {double v = a[i*n+j];
+         for(int k = 0; k < j; k++) v -= a[i*n+k] * a[j*n+k];
+         a[i*n+j] = v / h;
+        }
+     for(int k = j + 1; k < n; k++) a[j*n+k] = 0;
+    }
+ return true;
+}
+
+// a gamma(shape, 1) variate (Marsaglia and Tsang, 2000)
+inline double mvn_gamma(xoshiro256* g, double shape)
+{double u, z;
+ if(shape < 1)
+   {sample_uniform(g, &u, 1);
+    return mvn_gamma(g, shape + 1) * std::pow(u, 1 / shape);
+   }
+ double d = shape - 1.0 / 3, c = 1 / std::sqrt(9 * d);
+ for(;;)
+   {double v;
+    do
+      {sample_normal(g, &z, 1, 0, 1);
+       v = 1 + c * z;
+      }
+    while(v <= 0);
+    v = v * v * v;
+    sample_uniform(g, &u, 1);
+    if(std::log(u) < 0.5 * z * z + d - d * v + d * std::log(v)) return d * v;
+   }
+}
+
+// the I-step: draw the missing values given t into ymis (mvn_nmis(d)
+// of them), and add the sums of the completed rows and of their cross
+// products to t1 (p) and t2 (p x p); st must be unweighted
+inline void mvn_i_step(const mvn_data& d, const mvn_stats& st, const mvn_theta& t,
+                       xoshiro256* rng, double* ymis, double* t1, double* t2)
+{int p = d.p;
+ std::vector<double> g, a, c;
+ sample_normal(rng, ymis, mvn_nmis(d), 0, 1);
+ for(std::size_t k = 0; k < d.pat.size(); k++)
+    {const mvn_pattern& q = d.pat[k];
+     const std::vector<double>& s = st.s[k];
+     const std::vector<double>& ss = st.ss[k];
+     int no = (int)q.obs.size(), nm = (int)q.mis.size();
+     for(int o = 0; o < no; o++)
+        {t1[q.obs[o]] += s[o];
+         for(int r = 0; r < no; r++) t2[q.obs[o]*p+q.obs[r]] += ss[o*no+r];
+        }
+     if(nm == 0) continue;
+
+     // x_mis = a + B x_obs + L z with L L' = C, as in mvn_em_step
+     g = t.sigma;
+     for(int o = 0; o < no; o++) mvn_sweep(g, p, q.obs[o]);
+     a.assign(nm, 0.0);
+     c.assign((std::size_t)nm * nm, 0.0);
+     for(int m = 0; m < nm; m++)
+        {a[m] = t.mu[q.mis[m]];
+         for(int o = 0; o < no; o++) a[m] -= g[q.mis[m]*p+q.obs[o]] * t.mu[q.obs[o]];
+         for(int l = 0; l < nm; l++) c[m*nm+l] = g[q.mis[m]*p+q.mis[l]];
+        }
+     if(!mvn_chol(c, nm)) std::fill(c.begin(), c.end(), 0.0);
+     for(std::size_t r = 0; r < q.count; r++, ymis += nm)
+        {const double* x = &MATRIX_D(&q.x, r, 0);
+         // from the last, so that z can be replaced as it is used
+         for(int m = nm - 1; m >= 0; m--)
+            {double v = a[m];
+             for(int o = 0; o < no; o++) v += g[q.mis[m]*p+q.obs[o]] * x[o];
+             for(int l = 0; l <= m; l++) v += c[m*nm+l] * ymis[l];
+             ymis[m] = v;
+            }
+         for(int m = 0; m < nm; m++)
+            {int i = q.mis[m];
+             t1[i] += ymis[m];
+             for(int o = 0; o < no; o++)
+                {t2[i*p+q.obs[o]] += ymis[m] * x[o];
+                 t2[q.obs[o]*p+i] += ymis[m] * x[o];
+                }
+             for(int l = 0; l < nm; l++) t2[i*p+q.mis[l]] += ymis[m] * ymis[l];
+            }
+        }
+    }
+}
+
+// the P-step: draw t from the posterior given the sums t1 and t2 of n
+// completed rows: sigma from the inverse Wishart with n-1 degrees of
+// freedom and scale A, the centered cross products, then mu from
+// N(t1/n, sigma/n). With A = L L' and W = T T' Wishart(n-1, I) by
+// Bartlett's decomposition, sigma = L W^-1 L' = (L T'^-1)(L T'^-1)'.
+inline void mvn_p_step(int p, double n, const double* t1, const double* t2,
+                       xoshiro256* g, mvn_theta& t)
+{std::vector<double> l((std::size_t)p * p), u((std::size_t)p * p, 0.0), m((std::size_t)p * p);
+ for(int j = 0; j < p; j++)
+    for(int k = 0; k < p; k++) l[j*p+k] = t2[j*p+k] - t1[j] * t1[k] / n;
+ if(!mvn_chol(l, p)) return; // a degenerate draw: keep t
+ // T, then U = T^-1, both lower triangular
+ for(int j = 0; j < p; j++)
+    {u[j*p+j] = std::sqrt(2 * mvn_gamma(g, (n - 1 - j) / 2));
+     if(j > 0) sample_normal(g, &u[j*p], j, 0, 1);
+    }
+ for(int j = 0; j < p; j++)
+    {double h = u[j*p+j];
+     for(int k = 0; k < j; k++)
+        {double v = 0;
+         for(int i = k; i < j; i++) v -= u[j*p+i] * u[i*p+k];
+         u[j*p+k] = v / h;
+        }
+     u[j*p+j] = 1 / h;
+    }
+ // M = L U', sigma = M M' and mu = t1/n + M z / sqrt(n); L and U are
+ // both lower triangular, so only i <= min(j, k) adds to M[j][k]
+ for(int j = 0; j < p; j++)
+    for(int k = 0; k < p; k++)
+       {double v = 0;
+        for(int i = 0; i <= std::min(j, k); i++) v += l[j*p+i] * u[k*p+i];
+        m[j*p+k] = v;
+       }
+ std::vector<double> z(p);
+ sample_normal(g, z.data(), p, 0, 1);
+ t.mu.resize(p);
+ t.sigma.resize((std::size_t)p * p);
+ for(int j = 0; j < p; j++)
+    {double v = 0;
+     for(int k = 0; k < p; k++)
+        {double w = 0;
+         for(int i = 0; i < p; i++) w += m[j*p+i] * m[k*p+i];
+         t.sigma[j*p+k] = w;
+         v += m[j*p+k] * z[k];
+        }
+     t.mu[j] = t1[j] / n + v / std::sqrt(n);
+    }
+}
+
+// steps of data augmentation from t: the missing values of the last
+// I-step in ymis, and the sums of the rows it completed in t1 and t2;
+// t is the last draw of the P-step
+inline void mvn_da(const mvn_data& d, const mvn_stats& st, mvn_theta& t, int steps,
+                   xoshiro256* g, double* ymis, std::vector<double>& t1,
+                   std::vector<double>& t2)
+{int p = d.p;
+ for(int s = 0; s < steps; s++)
+    {t1.assign(p, 0.0);
+     t2.assign((std::size_t)p * p, 0.0);
+     mvn_i_step(d, st, t, g, ymis, t1.data(), t2.data());
+     mvn_p_step(p, st.total, t1.data(), t2.data(), g, t);
+    }
+}
+
+// f(0), ..., f(njobs-1) on nthreads threads (0: one per core), each
+// thread taking the next job when it is done with one
+template<class F> void mvn_parallel(std::size_t njobs, int nthreads, F f)
+{std::atomic<std::size_t> next(0);
+ auto work = [&] {for(std::size_t k; (k = next++) < njobs; ) f(k);};
+ if(nthreads <= 0) nthreads = (int)std::thread::hardware_concurrency();
+ if(nthreads <= 0) nthreads = 1;
+ if((std::size_t)nthreads > njobs) nthreads = (int)std::max(njobs, (std::size_t)1);
+ std::vector<std::thread> th;
+ for(int k = 1; k < nthreads; k++) th.emplace_back(work);
+ work();
+ for(auto& x: th) x.join();
+}
+
+#endif // MVNORM_H
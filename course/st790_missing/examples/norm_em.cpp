@@ -0,0 +1,164 @@
+// File: st790_missing/examples/norm_em.cpp
+// The EM fits of norm_em.R and bvnormal_em.R without R: the maximum
+// likelihood estimates of the mean and covariance of multivariate normal
+// data with missing values ("NA" or "."), by the EM algorithm of em.norm
+// (see mvnorm.h), and optionally their nonparametric bootstrap standard
+// errors. All the fits, of all files and bootstrap samples, run in
+// parallel.
+// run as "norm_em [-c] [-e criterion] [-m maxits] [-b B] [-s seed] [-j threads] file..."
+//   -c  start from the complete case estimates, as the R scripts do,
+//       instead of em.norm's default start
+//   -e, -m  em.norm's criterion (default 1e-4) and maxits (default 1000)
+//   -b  the number of bootstrap samples (default 0)
+// e.g. "norm_em -c -e 1e-5 -m 100 -b 250 bvnormal.dat" gives the theta
+// of norm_em.R: 4.991665 7.926339 1.016241 0.514838 1.098030
+// compile as
+//   "gcc -c -Wall -std=c99 -O3 -ffp-contract=fast ../../MA792-002/CExamples/blas.c ../../MA792-002/CExamples/matrix.c"
+//   "g++ -Wall -std=c++17 -O2 -pthread -iquote ../../MA792-002/CExamples -iquote ../../MA792-002/CppExamples norm_em.cpp blas.o matrix.o"
+// (-iquote, not -I: MA792-002/CExamples has a stdlib.h of its own)
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "records.h"
+#include "xoshiro.h"
+#include "mvnorm.h"
+
+// a fit of a file or of one of its bootstrap samples
+struct fit
+{std::size_t file;
+ int sample; // 0 for the data, else the bootstrap sample
+ mvn_theta theta;
+ int its;
+};
+
+// mu, then the upper triangle of sigma by rows: the theta of the R scripts
+static std::vector<double> flat(const mvn_theta& t, int p)
+{std::vector<double> v(t.mu);
+ for(int j = 0; j < p; j++)
+    for(int k = j; k < p; k++) v.push_back(t.sigma[j*p+k]);
+ return v;
+}
+
+int main(int argc, char** argv)
+{int opt, maxits = 1000, nboot = 0, nthreads = 0;
+ bool cc = false;
+ double criterion = 1e-4;
+ unsigned long long seed = 4;
+
+ while((opt = getopt(argc, argv, "ce:m:b:s:j:")) != -1)
+    switch(opt){
+    case 'c': cc = true; break;
+    case 'e': criterion = std::atof(optarg); break;
+    case 'm': maxits = std::atoi(optarg); break;
+    case 'b': nboot = std::atoi(optarg); break;
+    case 's': seed = std::strtoull(optarg, nullptr, 0); break;
+    case 'j': nthreads = std::atoi(optarg); break;
+    default:
+      std::fprintf(stderr, "usage: %s [-c] [-e criterion] [-m maxits] [-b B] [-s seed]"
+                           " [-j threads] file...\n", argv[0]);
+      return 1;
+    }
+ if(optind == argc)
+   {std::fprintf(stderr, "usage: %s [-c] [-e criterion] [-m maxits] [-b B] [-s seed]"
+                         " [-j threads] file...\n", argv[0]);
+    return 1;
+   }
+
+ // read the files into patterns
+ std::vector<std::unique_ptr<mvn_data>> data;
+ std::vector<std::unique_ptr<mvn_stats>> stats;
+ for(int a = optind; a < argc; a++)
+    {mapped_file in;
+     table t;
+     if(in.open(argv[a]) < 0)
+       {std::perror(argv[a]);
+        return 1;
+       }
+     // as many double columns as the first row has
+     const char* p = records_detail::skip_space(in.data(), in.data() + in.size());
+     const char* e = records_detail::line_end(p, in.data() + in.size());
+     std::string types;
+     while(p < e)
+       {while(p < e && !records_detail::is_space(*p)) p++;
+        types += 'd';
+        p = records_detail::skip_space(p, e);
+       }
+     table_status st = parse_table(in.data(), in.size(), types.c_str(), t, 1);
+     if(types.empty() || st.line != 0)
+       {std::fprintf(stderr, "%s:%zu: cannot read field %d\n", argv[a], st.line, st.field);
+        return 1;
+       }
+     int ncol = (int)types.size();
+     std::vector<double> x(t.rows * ncol);
+     for(std::size_t i = 0; i < t.rows; i++)
+        for(int j = 0; j < ncol; j++) x[i*ncol+j] = t.col[j].x[i];
+     data.emplace_back(new mvn_data(x.data(), t.rows, ncol, ncol));
+     stats.emplace_back(new mvn_stats(*data.back()));
+    }
+
+ // the fits, file by file, the data first
+ std::vector<fit> fits;
+ for(std::size_t f = 0; f < data.size(); f++)
+    for(int b = 0; b <= nboot; b++) fits.push_back({f, b, mvn_theta(), 0});
+
+ mvn_parallel(fits.size(), nthreads, [&](std::size_t k)
+   {fit& r = fits[k];
+    const mvn_data& d = *data[r.file];
+    std::unique_ptr<mvn_stats> boot;
+    const mvn_stats* st = stats[r.file].get();
+    if(r.sample > 0)
+      {// n rows drawn with replacement, as counts per row
+       std::vector<double> w(d.n, 0.0);
+       xoshiro256 g;
+       xoshiro256_seed(&g, seed + 0x9e3779b97f4a7c15ULL * (r.file * (nboot + 1) + r.sample));
+       for(std::size_t i = 0; i < d.n; i++)
+          w[(std::size_t)(((unsigned __int128)xoshiro256_next(&g) * d.n) >> 64)] += 1;
+       boot.reset(new mvn_stats(d, w.data()));
+       st = boot.get();
+      }
+    r.theta = cc ? mvn_start_cc(d, *st) : mvn_start(d);
+    r.its = mvn_em(d, *st, r.theta, maxits, criterion);
+   });
+
+ for(std::size_t f = 0; f < data.size(); f++)
+    {const mvn_data& d = *data[f];
+     int p = d.p;
+     const fit& r = fits[f * (nboot + 1)];
+     mvn_theta t = d.original(r.theta);
+     std::vector<double> th = flat(t, p);
+
+     std::printf("%s: %zu rows, %d columns, %zu patterns\n", argv[optind + f], d.n, p,
+                 d.pat.size());
+     std::printf("Iterations of EM: \n");
+     for(int i = 1; i <= r.its; i++) std::printf("%d...", i);
+     std::printf("\nmu\n");
+     for(int j = 0; j < p; j++) std::printf(" %.6f", t.mu[j]);
+     std::printf("\nSigma\n");
+     for(int j = 0; j < p; j++)
+        {for(int k = 0; k < p; k++) std::printf(" %.6f", t.sigma[j*p+k]);
+         std::printf("\n");
+        }
+     std::printf("theta\n");
+     for(double v: th) std::printf(" %.6f", v);
+     std::printf("\n");
+
+     if(nboot > 0)
+       {std::vector<double> s(th.size(), 0.0), ss(th.size(), 0.0);
+        for(int b = 1; b <= nboot; b++)
+           {std::vector<double> v = flat(d.original(fits[f * (nboot + 1) + b].theta), p);
+            for(std::size_t i = 0; i < v.size(); i++) {s[i] += v[i]; ss[i] += v[i] * v[i];}
+           }
+        std::printf("Bootstrap standard errors (%d samples)\n", nboot);
+        for(std::size_t i = 0; i < th.size(); i++)
+           std::printf(" %.6f", nboot > 1 ? std::sqrt((ss[i] - s[i] * s[i] / nboot) / (nboot - 1)) : 0.0);
+        std::printf("\n");
+       }
+     std::printf("\n");
+    }
+ return 0;
+}
@@ -0,0 +1,212 @@
+// File: st790_missing/examples/norm_mi.cpp
+// The multiple imputation of norm_mi.R without R: M imputations of the
+// missing values ("NA" or ".") of multivariate normal data, each the
+// last draw of its own chain of data augmentation (da.norm, see
+// mvnorm.h) started from the EM estimate, and the analysis of
+// norm_mi.R, the mean of each column with the covariance of the means
+// that gls() gives, combined by Rubin's rules (rubin.h).
+// The M chains run in parallel, chain m drawing from its own
+// xoshiro256** stream seeded from (seed, m), so the results do not
+// depend on the number of threads. An imputation is kept as its
+// missing values only, not as a copy of the data; -o writes them all,
+// one line per missing value: its row and column (from 1) and its M
+// imputations.
+// -c checks the P-step instead (mvn_p_step in mvnorm.h): it draws mu and
+// sigma 200000 times for p = 3 and n = 12 and compares their means with
+// E sigma = A/(n - p - 2) of the inverse Wishart and E mu = t1/n.
+// run as "norm_mi [-M imputations] [-n steps] [-s seed] [-j threads] [-o file] file"
+//     or "norm_mi -c [-s seed]"
+//   -M  the number of imputations (default 10)
+//   -n  the steps of each chain, the steps of da.norm (default 200)
+// compile as
+//   "gcc -c -Wall -std=c99 -O3 -ffp-contract=fast ../../MA792-002/CExamples/blas.c ../../MA792-002/CExamples/matrix.c ../../MA792-002/CExamples/sample.c"
+//   "g++ -Wall -std=c++17 -O2 -pthread -iquote ../../MA792-002/CExamples -iquote ../../MA792-002/CppExamples norm_mi.cpp blas.o matrix.o sample.o -lm"
+// (-iquote, not -I: MA792-002/CExamples has a stdlib.h of its own)
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "records.h"
+#include "xoshiro.h"
+#include "mvnorm.h"
+#include "rubin.h"
+
+static void print_matrix(const char* name, const std::vector<double>& a, int p)
+{std::printf("%s\n", name);
+ for(int j = 0; j < p; j++)
+    {std::printf(" y%-3d", j + 1);
+     for(int k = 0; k < p; k++) std::printf(" %13.6e", a[j*p+k]);
+     std::printf("\n");
+    }
+}
+
+// the moment check of -c; returns the number of moments more than 5
+// standard errors from their expected values
+static int check_p_step(unsigned long long seed)
+{const int p = 3, draws = 200000;
+ const double n = 12, a[p*p] = {4, 2, 1, 2, 3, .5, 1, .5, 2}, t1[p] = {6, -3, 1.2};
+ // the sums of n rows whose centered cross products are A
+ double t2[p*p];
+ for(int j = 0; j < p; j++)
+    for(int k = 0; k < p; k++) t2[j*p+k] = a[j*p+k] + t1[j] * t1[k] / n;
+ // the sums and sums of squares of mu (p) and sigma (p*p)
+ std::vector<double> s(p + p*p, 0.0), ss(p + p*p, 0.0);
+ xoshiro256 g;
+ xoshiro256_seed(&g, seed);
+ mvn_theta t;
+ for(int r = 0; r < draws; r++)
+    {mvn_p_step(p, n, t1, t2, &g, t);
+     for(int j = 0; j < p + p*p; j++)
+        {double v = j < p ? t.mu[j] : t.sigma[j-p];
+         s[j] += v;
+         ss[j] += v * v;
+        }
+    }
+ int bad = 0;
+ std::printf("P-step, p = %d, n = %g, %d draws\n       mean    expected   z\n", p, n, draws);
+ for(int j = 0; j < p + p*p; j++)
+    {double want = j < p ? t1[j] / n : a[j-p] / (n - 1 - p - 1);
+     double mean = s[j] / draws, sd = std::sqrt((ss[j] / draws - mean * mean) / draws);
+     double z = (mean - want) / sd;
+     if(j < p) std::printf("mu%d    ", j + 1);
+     else std::printf("s%d%d    ", (j - p) / p + 1, (j - p) % p + 1);
+     std::printf("%8.5f %8.5f %6.2f%s\n", mean, want, z, std::fabs(z) > 5 ? "  WRONG" : "");
+     if(std::fabs(z) > 5) bad++;
+    }
+ return bad;
+}
+
+int main(int argc, char** argv)
+{int opt, nimp = 10, steps = 200, nthreads = 0;
+ bool check = false;
+ unsigned long long seed = 82;
+ const char* out = nullptr;
+
+ while((opt = getopt(argc, argv, "M:n:s:j:o:c")) != -1)
+    switch(opt){
+    case 'c': check = true; break;
+    case 'M': nimp = std::atoi(optarg); break;
+    case 'n': steps = std::atoi(optarg); break;
+    case 's': seed = std::strtoull(optarg, nullptr, 0); break;
+    case 'j': nthreads = std::atoi(optarg); break;
+    case 'o': out = optarg; break;
+    default:
+      std::fprintf(stderr, "usage: %s [-M imputations] [-n steps] [-s seed] [-j threads]"
+                           " [-o file] file\n   or: %s -c [-s seed]\n", argv[0], argv[0]);
+      return 1;
+    }
+ if(check) return check_p_step(seed) ? 1 : 0;
+ if(optind != argc - 1 || nimp < 2 || steps < 1)
+   {std::fprintf(stderr, "usage: %s [-M imputations] [-n steps] [-s seed] [-j threads]"
+                         " [-o file] file\n(at least 2 imputations and 1 step)\n", argv[0]);
+    return 1;
+   }
+ const char* name = argv[optind];
+
+ // the data, as many double columns as the first row has
+ mapped_file in;
+ table t;
+ if(in.open(name) < 0)
+   {std::perror(name);
+    return 1;
+   }
+ const char* p = records_detail::skip_space(in.data(), in.data() + in.size());
+ const char* e = records_detail::line_end(p, in.data() + in.size());
+ std::string types;
+ while(p < e)
+   {while(p < e && !records_detail::is_space(*p)) p++;
+    types += 'd';
+    p = records_detail::skip_space(p, e);
+   }
+ table_status ts = parse_table(in.data(), in.size(), types.c_str(), t, 1);
+ if(types.empty() || ts.line != 0)
+   {std::fprintf(stderr, "%s:%zu: cannot read field %d\n", name, ts.line, ts.field);
+    return 1;
+   }
+ int ncol = (int)types.size();
+ std::vector<double> x(t.rows * ncol);
+ for(std::size_t i = 0; i < t.rows; i++)
+    for(int j = 0; j < ncol; j++) x[i*ncol+j] = t.col[j].x[i];
+ mvn_data d(x.data(), t.rows, ncol, ncol);
+ mvn_stats st(d);
+ x.clear();
+ x.shrink_to_fit();
+ std::size_t nmis = mvn_nmis(d);
+ int np = d.p;
+
+ // the start of every chain
+ mvn_theta start = mvn_start(d);
+ int its = mvn_em(d, st, start);
+
+ // the chains: M sets of missing values, and the analysis of each
+ // completed data set on the scale of the data
+ auto t0 = std::chrono::steady_clock::now();
+ std::vector<double> ymis(nimp * nmis);
+ std::vector<std::vector<double>> est(nimp), cov(nimp);
+ mvn_parallel(nimp, nthreads, [&](std::size_t m)
+   {xoshiro256 g;
+    xoshiro256_seed(&g, seed + 0x9e3779b97f4a7c15ULL * (m + 1));
+    mvn_theta th = start;
+    std::vector<double> t1, t2;
+    mvn_da(d, st, th, steps, &g, &ymis[m * nmis], t1, t2);
+    double n = st.total;
+    est[m].resize(np);
+    cov[m].resize((std::size_t)np * np);
+    for(int j = 0; j < np; j++) est[m][j] = t1[j] / n * d.sdv[j] + d.xbar[j];
+    for(int j = 0; j < np; j++)
+       for(int k = 0; k < np; k++)
+          cov[m][j*np+k] = (t2[j*np+k] / n - t1[j] * t1[k] / (n * n)) / n * d.sdv[j] * d.sdv[k];
+   });
+ double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+ std::printf("%s: %zu rows, %d columns, %zu missing values; EM start in %d iterations\n",
+             name, d.n, np, nmis, its);
+ std::printf("%d imputations, %d steps each, in %.3f s\n\n", nimp, steps, sec);
+
+ mi_result r = mi_pool(est, cov);
+ std::printf("           Est      StdErr       Lower       Upper          DF         Min         Max\n");
+ for(int j = 0; j < np; j++)
+    {double lo = HUGE_VAL, hi = -HUGE_VAL;
+     for(int m = 0; m < nimp; m++) {lo = std::min(lo, est[m][j]); hi = std::max(hi, est[m][j]);}
+     std::printf(" y%-3d %11.6f %11.8f %11.6f %11.6f %11.4f %11.6f %11.6f\n", j + 1, r.est[j],
+                 r.std_err[j], r.lower[j], r.upper[j], r.df[j], lo, hi);
+    }
+ std::printf("\n");
+ print_matrix("within covariance", r.within, np);
+ print_matrix("between covariance", r.between, np);
+ print_matrix("Rubin covariance", r.cov_mat, np);
+
+ if(out)
+   {// the missing cells in the order of the data: (row, column, index)
+    struct cell {std::size_t row; int col; std::size_t k;};
+    std::vector<cell> cells;
+    cells.reserve(nmis);
+    std::size_t k = 0;
+    for(const mvn_pattern& q: d.pat)
+       for(std::size_t i = 0; i < q.count; i++)
+          for(int c: q.mis) cells.push_back({d.row[q.first + i], c, k++});
+    std::sort(cells.begin(), cells.end(), [](const cell& a, const cell& b)
+              {return a.row != b.row ? a.row < b.row : a.col < b.col;});
+    std::FILE* f = std::fopen(out, "w");
+    if(f == nullptr)
+      {std::perror(out);
+       return 1;
+      }
+    for(const cell& c: cells)
+       {std::fprintf(f, "%zu %d", c.row + 1, c.col + 1);
+        for(int m = 0; m < nimp; m++)
+           std::fprintf(f, " %.10g", ymis[m * nmis + c.k] * d.sdv[c.col] + d.xbar[c.col]);
+        std::fprintf(f, "\n");
+       }
+    if(std::fclose(f) != 0)
+      {std::perror(out);
+       return 1;
+      }
+   }
+ return 0;
+}
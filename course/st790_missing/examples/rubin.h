@@ -0,0 +1,113 @@
+// File: st790_missing/examples/rubin.h
+// Rubin's rules for combining the analyses of M imputed data sets
+// (Rubin, 1987), as mi.inference of the norm package and
+// mi.mv.inference of norm_mi.R and hyper_mi.R do: the estimate is the
+// mean qbar of the M estimates, and its covariance is the mean within
+// covariance W plus (1 + 1/M) times the between covariance B of the
+// estimates. For each element, r = (1 + 1/M) B / W, the degrees of
+// freedom are (M - 1)(1 + 1/r)^2 and the fraction of missing
+// information is (r + 2/(df + 3))/(r + 1).
+// Needs C++17.
+
+#ifndef RUBIN_H
+#define RUBIN_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+struct mi_result
+{std::vector<double> est, std_err, df, signif, lower, upper, r, fminf;
+ std::vector<double> within, between, cov_mat; // k x k, row major
+};
+
+// the regularized incomplete beta function I_x(a, b), by the continued
+// fraction of Numerical Recipes (Press et al., 1992, 6.4)
+inline double mi_ibeta(double x, double a, double b)
+{if(x <= 0) return 0;
+ if(x >= 1) return 1;
+ if(x > (a + 1) / (a + b + 2)) return 1 - mi_ibeta(1 - x, b, a);
+ const double tiny = 1e-300;
+ double front = std::exp(std::lgamma(a + b) - std::lgamma(a) - std::lgamma(b)
+                         + a * std::log(x) + b * std::log1p(-x)) / a;
+ double c = 1, d = 1 - (a + b) * x / (a + 1);
+ if(std::fabs(d) < tiny) d = tiny;
+ d = 1 / d;
+ double f = d;
+ for(int m = 1; m < 300; m++)
+    {for(int odd = 0; odd < 2; odd++)
+        {double num = odd ? -(a + m) * (a + b + m) * x / ((a + 2 * m) * (a + 2 * m + 1))
+                          : m * (b - m) * x / ((a + 2 * m - 1) * (a + 2 * m));
+         d = 1 + num * d;
+         if(std::fabs(d) < tiny) d = tiny;
+         c = 1 + num / c;
+         if(std::fabs(c) < tiny) c = tiny;
+         d = 1 / d;
+         f *= c * d;
+        }
+     if(std::fabs(c * d - 1) < 1e-15) break;
+    }
+ return front * f;
+}
+
+// P(T <= t) for T Student's t with nu degrees of freedom (normal for
+// infinite nu)
+inline double mi_pt(double t, double nu)
+{if(std::isinf(nu)) return 0.5 * std::erfc(-t / std::sqrt(2.0));
+ double tail = 0.5 * mi_ibeta(nu / (nu + t * t), nu / 2, 0.5);
+ return t > 0 ? 1 - tail : tail;
+}
+
+// the p quantile of Student's t with nu degrees of freedom, by bisection
+inline double mi_qt(double p, double nu)
+{if(p == 0.5) return 0;
+ if(p < 0.5) return -mi_qt(1 - p, nu);
+ double lo = 0, hi = 1;
+ while(mi_pt(hi, nu) < p) {lo = hi; hi *= 2;}
+ for(int i = 0; i < 200 && hi - lo > 1e-14 * hi; i++)
+    {double mid = (lo + hi) / 2;
+     (mi_pt(mid, nu) < p ? lo : hi) = mid;
+    }
+ return (lo + hi) / 2;
+}
+
+// combine the estimates q[m] (k each) and their covariances u[m] (k x k)
+inline mi_result mi_pool(const std::vector<std::vector<double>>& q,
+                         const std::vector<std::vector<double>>& u,
+                         double confidence = 0.95)
+{std::size_t m = q.size(), k = m ? q[0].size() : 0;
+ double f = 1 + 1.0 / m;
+ mi_result res;
+ res.est.assign(k, 0.0);
+ res.within.assign(k * k, 0.0);
+ res.between.assign(k * k, 0.0);
+ for(std::size_t i = 0; i < m; i++)
+    for(std::size_t j = 0; j < k; j++)
+       {res.est[j] += q[i][j] / m;
+        for(std::size_t l = 0; l < k; l++) res.within[j*k+l] += u[i][j*k+l] / m;
+       }
+ for(std::size_t i = 0; i < m; i++)
+    for(std::size_t j = 0; j < k; j++)
+       for(std::size_t l = 0; l < k; l++)
+          res.between[j*k+l] += (q[i][j] - res.est[j]) * (q[i][l] - res.est[l]) / (m - 1);
+ res.cov_mat.resize(k * k);
+ for(std::size_t j = 0; j < k * k; j++) res.cov_mat[j] = res.within[j] + f * res.between[j];
+
+ double alpha = 1 - (1 - confidence) / 2;
+ for(std::size_t j = 0; j < k; j++)
+    {double tm = res.cov_mat[j*k+j], rem = f * res.between[j*k+j] / res.within[j*k+j];
+     double nu = rem > 0 ? (m - 1) * (1 + 1 / rem) * (1 + 1 / rem) : HUGE_VAL;
+     double se = std::sqrt(tm), t = mi_qt(alpha, nu);
+     res.std_err.push_back(se);
+     res.df.push_back(nu);
+     res.lower.push_back(res.est[j] - t * se);
+     res.upper.push_back(res.est[j] + t * se);
+     res.signif.push_back(2 * (1 - mi_pt(std::fabs(res.est[j] / se), nu)));
+     res.r.push_back(rem);
+     res.fminf.push_back((rem + 2 / (nu + 3)) / (rem + 1));
+    }
+ return res;
+}
+
+#endif // RUBIN_H